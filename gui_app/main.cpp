@@ -3,19 +3,70 @@
 #include <RtAudio.h>
 #include "AudioFile.h"
 #include "reverb.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include <memory>
 
+// Output stream settings chosen in the UI
+struct StreamConfig {
+    RtAudio::Api api = RtAudio::UNSPECIFIED;
+    int device = -1;                // -1 = the API's default output device
+    unsigned int bufferFrames = 256;
+    bool minimizeLatency = false;   // RTAUDIO_MINIMIZE_LATENCY
+    bool scheduleRealtime = false;  // RTAUDIO_SCHEDULE_REALTIME
+    bool loop = true;
+};
+
+// Callback load and xruns, written by the audio thread and read by the UI
+struct StreamStats {
+    std::atomic<float> load{0.0f};      // smoothed DSP time / buffer period
+    std::atomic<float> peakLoad{0.0f};  // highest load since the UI last looked
+    std::atomic<unsigned int> xruns{0};
+    std::atomic<unsigned int> callbacks{0};
+};
+
 class AudioStream {
 public:
     AudioStream() : dac(std::make_unique<RtAudio>()) {}
 
-    bool start(const std::string& filePath) {
+    bool load(const std::string& filePath) {
+        stop();
         if (!audioFile.load(filePath)) {
             return false;
         }
 
-        reverb = std::make_unique<Reverb>(audioFile.getSampleRate());
+        // Switching files reuses the reverb and spreads clearing its tail
+        // over the first blocks played
+        if (reverb) {
+            reverb->set_sample_rate(audioFile.getSampleRate(), true);
+        } else {
+            reverb = std::make_unique<Reverb>(audioFile.getSampleRate());
+        }
+        reverb->set_enabled(enabled);
+        reverb->set_freeze(frozen);
+        reverb->set_wet(wet);
+        reverb->set_dry(dry);
+        reverb->set_decay(decay);
+        position = 0;
+        return true;
+    }
+
+    bool isLoaded() const {
+        return reverb != nullptr;
+    }
+
+    bool start(const StreamConfig& newConfig) {
+        stop();
+        if (!isLoaded()) {
+            return false;
+        }
+
+        if (newConfig.api != config.api || !dac) {
+            dac = std::make_unique<RtAudio>(newConfig.api);
+        }
+        config = newConfig;
 
         if (dac->getDeviceCount() < 1) {
             wxLogMessage("No audio devices found!");
@@ -23,87 +74,165 @@ public:
         }
 
         RtAudio::StreamParameters parameters;
-        parameters.deviceId = dac->getDefaultOutputDevice();
+        parameters.deviceId = (config.device >= 0) ? config.device : dac->getDefaultOutputDevice();
         parameters.nChannels = 2;
         parameters.firstChannel = 0;
-        unsigned int sampleRate = audioFile.getSampleRate();
-        bufferFrames = 256;
+
+        RtAudio::StreamOptions options;
+        options.flags = 0;
+        if (config.minimizeLatency) options.flags |= RTAUDIO_MINIMIZE_LATENCY;
+        if (config.scheduleRealtime) options.flags |= RTAUDIO_SCHEDULE_REALTIME;
+        options.streamName = "Reverb GUI";
+
+        sampleRate = audioFile.getSampleRate();
+        bufferFrames = config.bufferFrames;
+
+        stats.load = 0.0f;
+        stats.peakLoad = 0.0f;
+        stats.xruns = 0;
+        stats.callbacks = 0;
 
         try {
-            dac->openStream(&parameters, NULL, RTAUDIO_FLOAT32, sampleRate, &bufferFrames, &AudioStream::callback, this);
-            leftBuffer.resize(bufferFrames);
-            rightBuffer.resize(bufferFrames);
+            dac->openStream(&parameters, NULL, RTAUDIO_FLOAT32, sampleRate, &bufferFrames, &AudioStream::callback, this, &options);
             dac->startStream();
         } catch (RtAudioError& e) {
             wxLogError(wxString(e.getMessage()));
             return false;
         }
 
-        position = 0;
         return true;
     }
 
     void stop() {
-        if (dac->isStreamOpen()) {
+        if (dac && dac->isStreamOpen()) {
             dac->closeStream();
         }
     }
 
+    bool isRunning() const {
+        return dac && dac->isStreamRunning();
+    }
+
+    RtAudio& audio() {
+        return *dac;
+    }
+
+    // Buffer size the driver actually granted, which may differ from the request
+    unsigned int grantedBufferFrames() const {
+        return bufferFrames;
+    }
+
+    unsigned int streamSampleRate() const {
+        return sampleRate;
+    }
+
+    StreamStats& streamStats() {
+        return stats;
+    }
+
+    // Called from the UI thread. Reverb's setters are lock-free, so they
+    // can run while the audio callback is inside process().
     void toggleReverb(bool on) {
+        enabled = on;
         if(reverb) reverb->set_enabled(on);
     }
 
     void toggleFreeze(bool on) {
+        frozen = on;
         if(reverb) reverb->set_freeze(on);
     }
 
+    void setWet(float value) {
+        wet = value;
+        if(reverb) reverb->set_wet(value);
+    }
+
+    void setDry(float value) {
+        dry = value;
+        if(reverb) reverb->set_dry(value);
+    }
+
+    void setDecay(float value) {
+        decay = value;
+        if(reverb) reverb->set_decay(value);
+    }
+
 private:
     static int callback(void *outputBuffer, void *inputBuffer, unsigned int nBufferFrames,
                         double streamTime, RtAudioStreamStatus status, void *userData) {
         AudioStream* self = static_cast<AudioStream*>(userData);
         float *out = static_cast<float*>(outputBuffer);
+        auto begin = std::chrono::steady_clock::now();
 
-        for (unsigned int i = 0; i < nBufferFrames; i++) {
-            if (self->position >= self->audioFile.getNumSamplesPerChannel()) {
-                self->position = 0; // Loop for now
+        if (status & RTAUDIO_OUTPUT_UNDERFLOW) {
+            self->stats.xruns.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // The reverb reads straight from the file's planar samples and writes
+        // interleaved frames into the RtAudio buffer, splitting at the loop point
+        const size_t length = self->audioFile.getNumSamplesPerChannel();
+        const float *left = self->audioFile.samples[0].data();
+        const float *right = (self->audioFile.getNumChannels() == 1) ? left : self->audioFile.samples[1].data();
+
+        unsigned int done = 0;
+        while (done < nBufferFrames) {
+            if (self->position >= length) {
+                if (!self->config.loop || length == 0) {
+                    std::fill(out + 2 * done, out + 2 * nBufferFrames, 0.0f);
+                    break;
+                }
+                self->position = 0;
             }
+            unsigned int frames = static_cast<unsigned int>(
+                std::min<size_t>(nBufferFrames - done, length - self->position));
 
-            if (self->audioFile.getNumChannels() == 1) {
-                self->leftBuffer[i] = self->audioFile.samples[0][self->position];
-                self->rightBuffer[i] = self->audioFile.samples[0][self->position];
+            float *frameOut = out + 2 * done;
+            if(self->reverb) {
+                self->reverb->process_strided(left + self->position, right + self->position, 1,
+                                              frameOut, frameOut + 1, 2, frames);
             } else {
-                self->leftBuffer[i] = self->audioFile.samples[0][self->position];
-                self->rightBuffer[i] = self->audioFile.samples[1][self->position];
+                for (unsigned int i = 0; i < frames; i++) {
+                    frameOut[2 * i] = left[self->position + i];
+                    frameOut[2 * i + 1] = right[self->position + i];
+                }
             }
 
-            self->position++;
+            self->position += frames;
+            done += frames;
         }
 
-        if(self->reverb) {
-            self->reverb->process(self->leftBuffer.data(), self->rightBuffer.data(), nBufferFrames);
-        }
-
-        for (unsigned int i = 0; i < nBufferFrames; i++) {
-            *out++ = self->leftBuffer[i];
-            *out++ = self->rightBuffer[i];
+        // Callback load: time spent here against the period of one buffer
+        std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - begin;
+        float load = elapsed.count() * self->sampleRate / nBufferFrames;
+        float smoothed = self->stats.load.load(std::memory_order_relaxed);
+        self->stats.load.store(smoothed + (load - smoothed) * 0.05f, std::memory_order_relaxed);
+        if (load > self->stats.peakLoad.load(std::memory_order_relaxed)) {
+            self->stats.peakLoad.store(load, std::memory_order_relaxed);
         }
+        self->stats.callbacks.fetch_add(1, std::memory_order_relaxed);
 
         return 0;
     }
 
     std::unique_ptr<RtAudio> dac;
+    StreamConfig config;
+    StreamStats stats;
     AudioFile<float> audioFile;
     size_t position = 0;
     std::unique_ptr<Reverb> reverb;
-    unsigned int bufferFrames;
-    std::vector<float> leftBuffer;
-    std::vector<float> rightBuffer;
+    bool enabled = true;
+    bool frozen = false;
+    float wet = 0.5f;
+    float dry = 0.5f;
+    float decay = 1.0f;
+    unsigned int sampleRate = 0;
+    unsigned int bufferFrames = 0;
 };
 
 
 class ReverbFrame : public wxFrame {
 public:
-    ReverbFrame() : wxFrame(NULL, wxID_ANY, "Reverb GUI") {
+    ReverbFrame() : wxFrame(NULL, wxID_ANY, "Reverb GUI"), meterTimer(this) {
         wxPanel *panel = new wxPanel(this, wxID_ANY);
 
         wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
@@ -111,33 +240,144 @@ public:
         wxButton *loadButton = new wxButton(panel, wxID_ANY, "Load WAV");
         toggleButton = new wxToggleButton(panel, wxID_ANY, "Reverb");
         freezeButton = new wxToggleButton(panel, wxID_ANY, "Freeze");
+        toggleButton->SetValue(true);
+
+        // Sliders work in percent; decay scales the reverb time
+        wetSlider = new wxSlider(panel, wxID_ANY, 50, 0, 100);
+        drySlider = new wxSlider(panel, wxID_ANY, 50, 0, 100);
+        decaySlider = new wxSlider(panel, wxID_ANY, 100, 10, 400);
+
+        // Output stream settings, applied when a file is loaded or on Apply
+        apiChoice = new wxChoice(panel, wxID_ANY);
+        RtAudio::getCompiledApi(apis);
+        apiChoice->Append("Default");
+        for (RtAudio::Api api : apis) {
+            apiChoice->Append(wxString(RtAudio::getApiDisplayName(api)));
+        }
+        apiChoice->SetSelection(0);
+
+        deviceChoice = new wxChoice(panel, wxID_ANY);
+
+        bufferChoice = new wxChoice(panel, wxID_ANY);
+        for (unsigned int frames : BUFFER_SIZES) {
+            bufferChoice->Append(wxString::Format("%u frames", frames));
+        }
+        bufferChoice->SetSelection(3);  // 256
+
+        minimizeLatencyBox = new wxCheckBox(panel, wxID_ANY, "Minimize latency");
+        realtimeBox = new wxCheckBox(panel, wxID_ANY, "Realtime scheduling");
+        loopBox = new wxCheckBox(panel, wxID_ANY, "Loop");
+        loopBox->SetValue(true);
+        wxButton *applyButton = new wxButton(panel, wxID_ANY, "Apply");
+
+        loadGauge = new wxGauge(panel, wxID_ANY, 100);
+        statsText = new wxStaticText(panel, wxID_ANY, "Stopped");
 
         sizer->Add(loadButton, 0, wxALL | wxEXPAND, 5);
         sizer->Add(toggleButton, 0, wxALL | wxEXPAND, 5);
         sizer->Add(freezeButton, 0, wxALL | wxEXPAND, 5);
+        sizer->Add(new wxStaticText(panel, wxID_ANY, "Wet"), 0, wxLEFT | wxRIGHT, 5);
+        sizer->Add(wetSlider, 0, wxALL | wxEXPAND, 5);
+        sizer->Add(new wxStaticText(panel, wxID_ANY, "Dry"), 0, wxLEFT | wxRIGHT, 5);
+        sizer->Add(drySlider, 0, wxALL | wxEXPAND, 5);
+        sizer->Add(new wxStaticText(panel, wxID_ANY, "Decay"), 0, wxLEFT | wxRIGHT, 5);
+        sizer->Add(decaySlider, 0, wxALL | wxEXPAND, 5);
+        sizer->Add(new wxStaticText(panel, wxID_ANY, "Audio API / device / buffer"), 0, wxLEFT | wxRIGHT | wxTOP, 5);
+        sizer->Add(apiChoice, 0, wxALL | wxEXPAND, 5);
+        sizer->Add(deviceChoice, 0, wxALL | wxEXPAND, 5);
+        sizer->Add(bufferChoice, 0, wxALL | wxEXPAND, 5);
+        sizer->Add(minimizeLatencyBox, 0, wxALL, 5);
+        sizer->Add(realtimeBox, 0, wxALL, 5);
+        sizer->Add(loopBox, 0, wxALL, 5);
+        sizer->Add(applyButton, 0, wxALL | wxEXPAND, 5);
+        sizer->Add(new wxStaticText(panel, wxID_ANY, "Callback load"), 0, wxLEFT | wxRIGHT | wxTOP, 5);
+        sizer->Add(loadGauge, 0, wxALL | wxEXPAND, 5);
+        sizer->Add(statsText, 0, wxALL | wxEXPAND, 5);
 
         panel->SetSizerAndFit(sizer);
 
         loadButton->Bind(wxEVT_BUTTON, &ReverbFrame::OnLoad, this);
         toggleButton->Bind(wxEVT_TOGGLEBUTTON, &ReverbFrame::OnToggle, this);
         freezeButton->Bind(wxEVT_TOGGLEBUTTON, &ReverbFrame::OnFreeze, this);
+        wetSlider->Bind(wxEVT_SLIDER, &ReverbFrame::OnWet, this);
+        drySlider->Bind(wxEVT_SLIDER, &ReverbFrame::OnDry, this);
+        decaySlider->Bind(wxEVT_SLIDER, &ReverbFrame::OnDecay, this);
+        apiChoice->Bind(wxEVT_CHOICE, &ReverbFrame::OnApi, this);
+        applyButton->Bind(wxEVT_BUTTON, &ReverbFrame::OnApply, this);
+        Bind(wxEVT_TIMER, &ReverbFrame::OnMeter, this);
 
         Bind(wxEVT_CLOSE_WINDOW, &ReverbFrame::OnClose, this);
+
+        refreshDevices();
+        meterTimer.Start(100);
     }
 
 private:
+    static constexpr unsigned int BUFFER_SIZES[] = {32, 64, 128, 256, 512, 1024, 2048};
+
+    RtAudio::Api selectedApi() const {
+        int sel = apiChoice->GetSelection();
+        return (sel > 0) ? apis[sel - 1] : RtAudio::UNSPECIFIED;
+    }
+
+    // Lists output-capable devices of the selected API
+    void refreshDevices() {
+        deviceChoice->Clear();
+        deviceIds.clear();
+        deviceChoice->Append("Default output");
+        deviceIds.push_back(-1);
+
+        try {
+            RtAudio probe(selectedApi());
+            for (unsigned int i = 0; i < probe.getDeviceCount(); i++) {
+                RtAudio::DeviceInfo info = probe.getDeviceInfo(i);
+                if (info.probed && info.outputChannels >= 2) {
+                    deviceChoice->Append(wxString(info.name));
+                    deviceIds.push_back(static_cast<int>(i));
+                }
+            }
+        } catch (RtAudioError& e) {
+            wxLogError(wxString(e.getMessage()));
+        }
+        deviceChoice->SetSelection(0);
+    }
+
+    StreamConfig currentConfig() const {
+        StreamConfig config;
+        config.api = selectedApi();
+        config.device = deviceIds[std::max(0, deviceChoice->GetSelection())];
+        config.bufferFrames = BUFFER_SIZES[std::max(0, bufferChoice->GetSelection())];
+        config.minimizeLatency = minimizeLatencyBox->GetValue();
+        config.scheduleRealtime = realtimeBox->GetValue();
+        config.loop = loopBox->GetValue();
+        return config;
+    }
+
     void OnLoad(wxCommandEvent& event) {
         wxFileDialog openFileDialog(this, _("Open WAV file"), "", "",
                                    "WAV files (*.wav)|*.wav", wxFD_OPEN|wxFD_FILE_MUST_EXIST);
         if (openFileDialog.ShowModal() == wxID_CANCEL)
             return;
 
-        stream.stop();
-        if(!stream.start(openFileDialog.GetPath().ToStdString())) {
+        if(!stream.load(openFileDialog.GetPath().ToStdString())) {
+            wxLogError("Failed to load WAV file.");
+            return;
+        }
+        if(!stream.start(currentConfig())) {
+            wxLogError("Failed to start audio stream.");
+        }
+    }
+
+    void OnApply(wxCommandEvent& event) {
+        if (stream.isLoaded() && !stream.start(currentConfig())) {
             wxLogError("Failed to start audio stream.");
         }
     }
 
+    void OnApi(wxCommandEvent& event) {
+        refreshDevices();
+    }
+
     void OnToggle(wxCommandEvent& event) {
         stream.toggleReverb(event.IsChecked());
     }
@@ -146,14 +386,62 @@ private:
         stream.toggleFreeze(event.IsChecked());
     }
 
+    void OnWet(wxCommandEvent& event) {
+        stream.setWet(event.GetInt() / 100.0f);
+    }
+
+    void OnDry(wxCommandEvent& event) {
+        stream.setDry(event.GetInt() / 100.0f);
+    }
+
+    void OnDecay(wxCommandEvent& event) {
+        stream.setDecay(event.GetInt() / 100.0f);
+    }
+
+    // Shows the callback load against the buffer period and the xrun count
+    void OnMeter(wxTimerEvent& event) {
+        if (!stream.isRunning()) {
+            loadGauge->SetValue(0);
+            statsText->SetLabel("Stopped");
+            return;
+        }
+
+        StreamStats& stats = stream.streamStats();
+        float load = stats.load.load(std::memory_order_relaxed);
+        float peak = stats.peakLoad.exchange(0.0f, std::memory_order_relaxed);
+        unsigned int frames = stream.grantedBufferFrames();
+        double periodMs = 1000.0 * frames / stream.streamSampleRate();
+
+        loadGauge->SetValue(std::min(100, static_cast<int>(load * 100.0f)));
+        statsText->SetLabel(wxString::Format(
+            "%u frames (%.2f ms) / load %.1f%% / peak %.1f%% / xruns %u",
+            frames, periodMs, load * 100.0f, peak * 100.0f,
+            stats.xruns.load(std::memory_order_relaxed)));
+    }
+
     void OnClose(wxCloseEvent& event) {
+        meterTimer.Stop();
         stream.stop();
         Destroy();
     }
 
     AudioStream stream;
+    std::vector<RtAudio::Api> apis;
+    std::vector<int> deviceIds;
+    wxTimer meterTimer;
     wxToggleButton *toggleButton;
     wxToggleButton *freezeButton;
+    wxSlider *wetSlider;
+    wxSlider *drySlider;
+    wxSlider *decaySlider;
+    wxChoice *apiChoice;
+    wxChoice *deviceChoice;
+    wxChoice *bufferChoice;
+    wxCheckBox *minimizeLatencyBox;
+    wxCheckBox *realtimeBox;
+    wxCheckBox *loopBox;
+    wxGauge *loadGauge;
+    wxStaticText *statsText;
 };
 
 class ReverbApp : public wxApp {
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Stream format and buffer sizing shared by the USB descriptors
+ * (tusb_config.h), the ringbuffers and the audio task. Everything that holds
+ * audio is sized from these so the pieces cannot drift apart.
+ */
+
+// AUDIO_SAMPLE_RATE is the power-on rate; the host may switch to any of
+// AUDIO_SAMPLE_RATES (see usb_descriptors.c) without re-enumerating. Both
+// endpoints declare one wMaxPacketSize for AUDIO_MAX_SAMPLE_RATE, and at
+// 96 kHz two 32-bit stereo streams no longer fit a full-speed frame (see the
+// bus budget check below).
+#define AUDIO_SAMPLE_RATE 48000
+#define AUDIO_SAMPLE_RATES 44100, 48000
+#define AUDIO_MAX_SAMPLE_RATE 48000
+#define AUDIO_NUM_CHANNELS 2
+#define AUDIO_BITS_PER_SAMPLE 24
+#define AUDIO_BYTES_PER_SAMPLE 4                        // 32bit aligned (24bit data + padding)
+#define AUDIO_FRAME_SAMPLES (AUDIO_SAMPLE_RATE / 1000)  // 48 samples per frame at power-on
+#define AUDIO_FRAME_BYTES (AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS * AUDIO_BYTES_PER_SAMPLE)
+
+// Largest isochronous packet: one extra frame per USB frame for clock drift,
+// matching TUD_AUDIO_EP_SIZE() at full speed.
+#define AUDIO_PACKET_MAX_FRAMES (AUDIO_MAX_SAMPLE_RATE / 1000 + 1)
+#define AUDIO_PACKET_MAX_SAMPLES (AUDIO_PACKET_MAX_FRAMES * AUDIO_NUM_CHANNELS)
+#define AUDIO_PACKET_MAX_BYTES (AUDIO_PACKET_MAX_SAMPLES * AUDIO_BYTES_PER_SAMPLE)
+
+// Frames handed to fx_process per call.
+#define AUDIO_BLOCK_FRAMES 48
+#define AUDIO_BLOCK_SAMPLES (AUDIO_BLOCK_FRAMES * AUDIO_NUM_CHANNELS)
+
+// Ringbuffer capacity in int32_t samples (power of two), large enough for
+// RINGBUF_FRAMES worst-case packets.
+#define RINGBUF_FRAMES (8)
+#define RINGBUF_CAPACITY_LOG2 10
+#define RINGBUF_CAPACITY (1u << RINGBUF_CAPACITY_LOG2)
+
+_Static_assert(RINGBUF_CAPACITY >= RINGBUF_FRAMES * (AUDIO_MAX_SAMPLE_RATE / 1000) * AUDIO_NUM_CHANNELS,
+               "ringbuffer must hold RINGBUF_FRAMES USB frames");
+_Static_assert(RINGBUF_CAPACITY >= 2 * (AUDIO_PACKET_MAX_SAMPLES + AUDIO_BLOCK_SAMPLES),
+               "ringbuffer must hold a packet arriving while a block is pending");
+
+// Move audio between the USB endpoint FIFOs and the ringbuffers with DMA
+// (src/audio_dma.c) instead of CPU copies.
+#ifndef AUDIO_USE_DMA
+#define AUDIO_USE_DMA 0
+#endif
+
+// Declare the OUT endpoint asynchronous with a UAC2 explicit feedback
+// endpoint. The device then runs both streams at its own crystal clock and
+// steers the host's OUT rate through the feedback value, instead of
+// following the host with the IN packet size (src/latency.c).
+#ifndef AUDIO_USE_FEEDBACK_EP
+#define AUDIO_USE_FEEDBACK_EP 0
+#endif
+
+// Full-speed USB gives periodic transfers at most 90 % of each 1500-byte
+// frame, and every isochronous transaction costs 9 bytes of protocol
+// overhead on top of its data (USB 2.0, table 5-4). The OUT and IN streams
+// are reserved at their largest packet every frame, plus the 3-byte
+// feedback value when that endpoint is enabled.
+#define USB_FS_PERIODIC_BUDGET_BYTES 1350
+#define USB_FS_ISO_OVERHEAD_BYTES 9
+#define AUDIO_PERIODIC_BYTES                                                  \
+    (2 * (AUDIO_PACKET_MAX_BYTES + USB_FS_ISO_OVERHEAD_BYTES) +               \
+     (AUDIO_USE_FEEDBACK_EP ? 3 + USB_FS_ISO_OVERHEAD_BYTES : 0))
+
+_Static_assert(AUDIO_PERIODIC_BYTES <= USB_FS_PERIODIC_BUDGET_BYTES,
+               "audio endpoints exceed the full-speed periodic bandwidth at AUDIO_MAX_SAMPLE_RATE");
+
+// Latency management: the rx+tx ringbuffer fill is steered towards
+// AUDIO_TARGET_LATENCY_US, by varying the IN packet size by single frames
+// or, with AUDIO_USE_FEEDBACK_EP, through the feedback value. Beyond
+// AUDIO_MAX_LATENCY_US the excess is discarded in one step.
+#ifndef AUDIO_TARGET_LATENCY_US
+#define AUDIO_TARGET_LATENCY_US 2000
+#endif
+#ifndef AUDIO_MAX_LATENCY_US
+#define AUDIO_MAX_LATENCY_US 6000
+#endif
+
+_Static_assert((uint64_t)AUDIO_MAX_LATENCY_US * AUDIO_MAX_SAMPLE_RATE / 1000000 *
+                       AUDIO_NUM_CHANNELS <
+                   RINGBUF_CAPACITY,
+               "AUDIO_MAX_LATENCY_US does not fit in the ringbuffers");
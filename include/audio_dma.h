@@ -0,0 +1,36 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ringbuffer.h"
+
+/*
+ * DMA copies between the USB audio endpoint FIFOs and the ringbuffers, used
+ * by the TinyUSB callbacks in main.c when AUDIO_USE_DMA is set. The DMA
+ * ring-wrap addressing needs both ringbuffers aligned to their size
+ * (AUDIO_DMA_RING_ALIGNED).
+ */
+#define AUDIO_DMA_RING_ALIGNED __attribute__((aligned(RINGBUF_CAPACITY * sizeof(int32_t))))
+
+// Claims the DMA channels and installs the completion interrupt on the
+// calling core, which must be the one running the USB callbacks.
+void audio_dma_init(ringbuffer_t *rx, ringbuffer_t *tx);
+
+// Waits for the OUT transfer in flight, if any, so ringbuffer_capacity(rx)
+// is current.
+void audio_dma_rx_wait(void);
+
+// Starts moving the n_bytes just received from the OUT endpoint FIFO into
+// rx, which must have room for them. Returns at once; the samples are
+// committed to rx from the completion interrupt.
+void audio_dma_rx(uint16_t n_bytes);
+
+// Moves `samples` from tx into the IN endpoint FIFO, followed by
+// `pad_samples` of silence, and returns once they are in the FIFO.
+void audio_dma_tx(size_t samples, size_t pad_samples);
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DSP_STATS_HIST_BINS 32
+
+/*
+ * SysEx protocol (non-commercial manufacturer ID 0x7D):
+ *
+ *   host -> device  F0 7D 01 01 F7         request a stats report
+ *   host -> device  F0 7D 01 03 F7         reset the statistics
+ *   host -> device  F0 7D 01 05 <n> F7     stream telemetry every n * 10 ms (0 stops)
+ *   device -> host  F0 7D 01 02 <ver> <fields...> F7
+ *   device -> host  F0 7D 01 04 <ver> <seq> <program> <fields...> F7
+ *
+ * Each field of the report is a uint32_t sent as five 7-bit bytes, least
+ * significant first, in the order of dsp_stats_t, followed by the histogram.
+ *
+ * Telemetry frames are the compact live view, 22 bytes each. `seq` counts
+ * frames modulo 128 so the host can spot lost ones, and each field is a
+ * 14-bit value sent as two 7-bit bytes, least significant first:
+ *
+ *   load      average fx_process time since the previous frame, in 0.1 %
+ *             of the block budget
+ *   peak      longest block since the previous frame, same unit
+ *   rx, tx    ringbuffer fill in frames at the time of the frame
+ *   underruns, overruns, resyncs
+ *             latency counters since the last reset, modulo 16384
+ *
+ * Values above 16383 are clamped, apart from the counters, which wrap.
+ */
+#define DSP_SYSEX_MANUFACTURER 0x7D
+#define DSP_SYSEX_DEVICE 0x01
+#define DSP_SYSEX_CMD_REQUEST 0x01
+#define DSP_SYSEX_CMD_REPORT 0x02
+#define DSP_SYSEX_CMD_RESET 0x03
+#define DSP_SYSEX_CMD_TELEMETRY 0x04
+#define DSP_SYSEX_CMD_STREAM 0x05
+#define DSP_SYSEX_VERSION 1
+#define DSP_TELEMETRY_VERSION 1
+
+typedef struct {
+    uint32_t blocks;         // fx_process calls since the last reset
+    uint32_t budget_cycles;  // cycles available per block at the current rate
+    uint32_t min_cycles;
+    uint32_t avg_cycles;
+    uint32_t max_cycles;
+    uint32_t p99_cycles;     // upper edge of the histogram bin holding the 99th percentile
+    uint32_t underruns;
+    uint32_t overruns;
+    uint32_t resyncs;
+    uint32_t fill_frames;
+    uint32_t target_frames;
+    uint32_t hist_shift;     // histogram bin i covers [i << hist_shift, (i + 1) << hist_shift)
+    uint32_t hist[DSP_STATS_HIST_BINS];
+} dsp_stats_t;
+
+#define DSP_STATS_SYSEX_MAX (5 + sizeof(dsp_stats_t) / sizeof(uint32_t) * 5 + 1)
+#define DSP_TELEMETRY_SYSEX_LEN 22
+
+void dsp_stats_init(uint32_t budget_cycles);
+void dsp_stats_set_budget(uint32_t budget_cycles);
+uint32_t dsp_stats_begin(void);
+void dsp_stats_end(uint32_t start);
+void dsp_stats_reset(void);
+void dsp_stats_snapshot(dsp_stats_t *stats);
+size_t dsp_stats_encode_sysex(uint8_t *buf, size_t size);
+
+// Encodes a telemetry frame and starts the next telemetry window. Called
+// from the USB side only; rx_frames and tx_frames are the current fills.
+size_t dsp_stats_encode_telemetry(uint8_t *buf, size_t size, uint8_t program,
+                                  uint32_t rx_frames, uint32_t tx_frames);
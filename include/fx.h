@@ -1,13 +1,61 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "usb_descriptors.h"
 #include "fx_param.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Effect interface. Every effect keeps its state in its own statically
+ * sized storage and exports one fx_t; several can be compiled in and run
+ * in series. Effects must support in-place processing (output == input).
+ */
+typedef struct {
+    const char *name;
+    void (*init)(void);
+    void (*set_format)(uint8_t bit_rate, uint32_t sampling_rate);
+    void (*set_enable)(bool enable);
+    void (*set_param)(uint8_t id, int16_t val);
+    void (*process)(int32_t *output, int32_t *input, size_t frame_length);
+} fx_t;
+
+extern const fx_t fx_reverb;
+extern const fx_t fx_reverb_q31;  // fx_reverb with a 24-bit signal path
+extern const fx_t fx_granular;
+
+#define FX_CHAIN_MAX 2
+
+/*
+ * Effect chain (src/fx_chain.c). The functions below drive the active
+ * program, a series of up to FX_CHAIN_MAX effects. Format, enable and
+ * parameter changes go to every compiled-in effect, so each one keeps its
+ * settings while it is not in the chain.
+ *
+ * fx_set_enable and fx_set_param may be called from the other core at any
+ * rate. Only the latest enable state and value of each parameter are kept,
+ * and they reach the effects at the start of the next fx_process block. Ids
+ * from FX_PARAM_COUNT on are ignored.
+ */
 const char *fx_name(void);
 void fx_init(void);
 void fx_set_format(uint8_t bit_rate, uint32_t sampling_rate);
 void fx_set_enable(bool enable);
 void fx_process(int32_t *output, int32_t *input, size_t frame_length);
 void fx_set_param(uint8_t id, int16_t val);
+
+// Program selection, e.g. from MIDI program change. Safe to call from the
+// other core; the switch happens at the start of the next fx_process block,
+// and fx_current_program reports the program fx_process is running.
+size_t fx_program_count(void);
+void fx_select_program(uint8_t program);
+uint8_t fx_current_program(void);
+const char *fx_program_name(uint8_t program);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+/*
+ * Placement of the audio hot path.
+ *
+ * With AUDIO_HOT_PATH_IN_RAM (default on) the DSP functions, the
+ * ringbuffer and the coefficient tables they read are copied to SRAM at
+ * boot, so their timing does not depend on XIP cache misses caused by USB
+ * code. Per-block working buffers of the DSP core go to SCRATCH_X (SRAM4),
+ * which is not striped with the main SRAM banks that core0 works in. It
+ * also holds the core1 stack, growing down from its top, so only small
+ * buffers belong there.
+ *
+ * The delay lines are marked AUDIO_DSP_DATA(group). With the SDK's default
+ * memory map they are plain .bss; memmap_audio.ld gives the "reverb" group
+ * SRAM banks that neither core0, USB nor the ringbuffers use, and other
+ * groups a section of their own in the main RAM.
+ *
+ * Host builds (and AUDIO_HOT_PATH_IN_RAM=0) get plain declarations.
+ */
+#ifndef AUDIO_HOT_PATH_IN_RAM
+#define AUDIO_HOT_PATH_IN_RAM 1
+#endif
+
+#if AUDIO_HOT_PATH_IN_RAM && defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+#include "pico/platform.h"
+#define AUDIO_RAM_FUNC(func) __time_critical_func(func)
+#define AUDIO_RAM_DATA __not_in_flash("audio")
+#define AUDIO_CORE1_DATA __scratch_x("audio")
+#define AUDIO_DSP_DATA(group) __attribute__((section(".bss.audio_dsp." group)))
+#else
+#define AUDIO_RAM_FUNC(func) func
+#define AUDIO_RAM_DATA
+#define AUDIO_CORE1_DATA
+#define AUDIO_DSP_DATA(group)
+#endif
+
+// For kernels specialised by a constant argument (the C counterpart of a
+// template parameter): every call site gets its own copy with the branches
+// on that argument folded away.
+#if defined(__GNUC__)
+#define AUDIO_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define AUDIO_FORCE_INLINE inline
+#endif
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t underruns;     // IN packets that could not be filled from tx_buffer
+    uint32_t overruns;      // OUT packets dropped because rx_buffer was full
+    uint32_t resyncs;       // times the fill exceeded AUDIO_MAX_LATENCY_US
+    uint32_t fill_frames;   // filtered rx+tx fill left after each IN packet
+    uint32_t target_frames;
+} latency_stats_t;
+
+void latency_init(uint32_t sample_rate);
+uint32_t latency_sample_rate(void);
+uint32_t latency_next_packet_frames(size_t buffered_frames);
+size_t latency_excess_frames(size_t buffered_frames);
+
+// With AUDIO_USE_FEEDBACK_EP: called for every SOF with its frame number, the device time in microseconds and the rx+tx fill. Returns
+// the rate the host should send at, in frames per USB frame as Q16.16.
+uint32_t latency_feedback_q16(uint32_t frame_number, uint32_t now_us, size_t buffered_frames);
+void latency_count_underrun(void);
+void latency_count_overrun(void);
+const latency_stats_t *latency_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
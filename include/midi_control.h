@@ -0,0 +1,36 @@
+/*
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * MIDI Control Change input, on any channel:
+ *
+ *   CC n (n < FX_PARAM_COUNT)    parameter n, 7-bit value
+ *   CC 99 / 98                   NRPN number MSB / LSB: parameter n is NRPN n
+ *   CC 6 / 38                    data entry MSB / LSB, 14-bit value
+ *   CC 101 / 100                 RPN number, deselects the NRPN (RPNs are ignored)
+ *
+ * Values are scaled to Q15 through lookup tables and passed to
+ * fx_set_param, which coalesces them until the next audio block. A data
+ * entry MSB applies at once with the LSB cleared; a following LSB refines it.
+ */
+void midi_control_change(uint8_t controller, uint8_t value);
+
+// Q15 value of a 7-bit CC value, equal to F32_Q15(value / 127.0f)
+int16_t midi_cc_to_q15(uint8_t value);
+
+// Q15 value of a 14-bit NRPN value (0..16383), full scale at 16383
+int16_t midi_nrpn_to_q15(uint16_t value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,26 +1,40 @@
 #pragma once
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
 
-#define AUDIO_SAMPLE_RATE 48000
-#define AUDIO_NUM_CHANNELS 2
-#define AUDIO_BITS_PER_SAMPLE 24
-#define AUDIO_BYTES_PER_SAMPLE 4                        // 32bit aligned (24bit data + padding)
-#define AUDIO_FRAME_SAMPLES (AUDIO_SAMPLE_RATE / 1000)  // 48 samples per frame
-#define AUDIO_FRAME_BYTES (AUDIO_FRAME_SAMPLES * AUDIO_NUM_CHANNELS * AUDIO_BYTES_PER_SAMPLE)
+#include "audio_config.h"
 
-#define RINGBUF_FRAMES (8)
-#define TOTAL_SAMPLES (RINGBUF_FRAMES * AUDIO_FRAME_SAMPLES)
+#define RINGBUF_MASK (RINGBUF_CAPACITY - 1)
 
+/*
+ * Lock-free single-producer / single-consumer queue of int32_t samples.
+ *
+ * `write` is only stored by the producer and `read` only by the consumer.
+ * Both are free-running counters; the producer publishes samples with a
+ * release store of `write` and the consumer returns space with a release
+ * store of `read`, so the two sides may live on different cores or in an
+ * interrupt handler.
+ */
 typedef struct {
-    int32_t buffer[RINGBUF_FRAMES * AUDIO_FRAME_BYTES];
-    volatile size_t read;
-    volatile size_t write;
+    int32_t buffer[RINGBUF_CAPACITY];
+    atomic_size_t read;
+    atomic_size_t write;
 } ringbuffer_t;
 
 bool ringbuffer_push(ringbuffer_t *buffer, int32_t *data, size_t size);
 bool ringbuffer_pop(ringbuffer_t *buffer, int32_t *data, size_t size);
 size_t ringbuffer_capacity(ringbuffer_t *buffer);
 size_t ringbuffer_size(ringbuffer_t *buffer);
+
+// Zero-copy producer side: returns a pointer to the next free slot and stores
+// the number of contiguous free samples (up to the wrap point) in *size.
+int32_t *ringbuffer_reserve_write(ringbuffer_t *buffer, size_t *size);
+void ringbuffer_commit_write(ringbuffer_t *buffer, size_t size);
+
+// Zero-copy consumer side: returns a pointer to the oldest sample and stores
+// the number of contiguous readable samples (up to the wrap point) in *size.
+int32_t *ringbuffer_peek_read(ringbuffer_t *buffer, size_t *size);
+void ringbuffer_release_read(ringbuffer_t *buffer, size_t size);
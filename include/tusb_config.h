@@ -4,6 +4,7 @@
 extern "C" {
 #endif
 
+#include "audio_config.h"
 #include "usb_descriptors.h"
 
 #define BOARD_TUD_RHPORT      0
@@ -30,14 +31,14 @@ extern "C" {
 #define CFG_TUD_AUDIO_FUNC_1_DESC_LEN                        TUD_AUDIO_INTERFACE_STEREO_DESC_LEN
 #define CFG_TUD_AUDIO_FUNC_1_N_FORMATS                       1
 
-#define CFG_TUD_AUDIO_FUNC_1_MAX_SAMPLE_RATE                 48000
-#define CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX                   2
-#define CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX                   2
+#define CFG_TUD_AUDIO_FUNC_1_MAX_SAMPLE_RATE                 AUDIO_MAX_SAMPLE_RATE
+#define CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX                   AUDIO_NUM_CHANNELS
+#define CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX                   AUDIO_NUM_CHANNELS
 // 24bit in 32bit slots
-#define CFG_TUD_AUDIO_FUNC_1_FORMAT_1_N_BYTES_PER_SAMPLE_TX  4
-#define CFG_TUD_AUDIO_FUNC_1_FORMAT_1_RESOLUTION_TX          32
-#define CFG_TUD_AUDIO_FUNC_1_FORMAT_1_N_BYTES_PER_SAMPLE_RX  4
-#define CFG_TUD_AUDIO_FUNC_1_FORMAT_1_RESOLUTION_RX          32
+#define CFG_TUD_AUDIO_FUNC_1_FORMAT_1_N_BYTES_PER_SAMPLE_TX  AUDIO_BYTES_PER_SAMPLE
+#define CFG_TUD_AUDIO_FUNC_1_FORMAT_1_RESOLUTION_TX          (AUDIO_BYTES_PER_SAMPLE * 8)
+#define CFG_TUD_AUDIO_FUNC_1_FORMAT_1_N_BYTES_PER_SAMPLE_RX  AUDIO_BYTES_PER_SAMPLE
+#define CFG_TUD_AUDIO_FUNC_1_FORMAT_1_RESOLUTION_RX          (AUDIO_BYTES_PER_SAMPLE * 8)
 
 #define CFG_TUD_AUDIO_ENABLE_EP_IN                1
 
@@ -53,6 +54,11 @@ extern "C" {
 #define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ     (CFG_TUD_AUDIO_FUNC_1_FORMAT_1_EP_SZ_OUT*4+64)
 #define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX        (CFG_TUD_AUDIO_FUNC_1_FORMAT_1_EP_SZ_OUT)
 
+// Explicit feedback for the asynchronous OUT endpoint. The value is computed
+// by src/latency.c in 16.16 and converted to 10.14 on full speed by TinyUSB.
+#define CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP                 AUDIO_USE_FEEDBACK_EP
+#define CFG_TUD_AUDIO_ENABLE_FEEDBACK_FORMAT_CORRECTION  AUDIO_USE_FEEDBACK_EP
+
 #define CFG_TUD_AUDIO_FUNC_1_N_AS_INT             2
 
 #define CFG_TUD_AUDIO_FUNC_1_CTRL_BUF_SZ          64
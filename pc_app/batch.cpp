@@ -0,0 +1,177 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+    struct Job {
+        fs::path input;
+        fs::path output;
+    };
+
+    // One deque per worker. A worker takes from the front of its own deque
+    // and, once that is empty, steals from the back of the others, so a
+    // worker stuck on a long file does not hold up the short ones queued
+    // behind it.
+    class WorkStealingQueues {
+    public:
+        WorkStealingQueues(size_t num_jobs, int workers) : queues_(workers) {
+            for (size_t i = 0; i < num_jobs; ++i) {
+                queues_[i % workers].jobs.push_back(i);
+            }
+        }
+
+        bool pop(int worker, size_t &job) {
+            {
+                Queue &own = queues_[worker];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.jobs.empty()) {
+                    job = own.jobs.front();
+                    own.jobs.pop_front();
+                    return true;
+                }
+            }
+            for (size_t i = 1; i < queues_.size(); ++i) {
+                Queue &victim = queues_[(worker + i) % queues_.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.jobs.empty()) {
+                    job = victim.jobs.back();
+                    victim.jobs.pop_back();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<size_t> jobs;
+        };
+        std::vector<Queue> queues_;
+    };
+
+    bool is_wav(const fs::path &path) {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+        return ext == ".wav";
+    }
+
+    void collect_jobs(const std::string &input, const fs::path &output_dir, std::vector<Job> &jobs) {
+        if (!input.empty() && input[0] == '@') {
+            std::ifstream list(input.substr(1));
+            if (!list) {
+                std::cerr << "Error: Could not read file list " << input.substr(1) << std::endl;
+                return;
+            }
+            std::string line;
+            while (std::getline(list, line)) {
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (!line.empty()) {
+                    collect_jobs(line, output_dir, jobs);
+                }
+            }
+            return;
+        }
+
+        fs::path path(input);
+        std::error_code ec;
+        if (fs::is_directory(path, ec)) {
+            for (const auto &entry : fs::recursive_directory_iterator(path, ec)) {
+                if (entry.is_regular_file(ec) && is_wav(entry.path())) {
+                    jobs.push_back({entry.path(), output_dir / fs::relative(entry.path(), path, ec)});
+                }
+            }
+        } else {
+            jobs.push_back({path, output_dir / path.filename()});
+        }
+    }
+}
+
+int run_batch(const std::vector<std::string> &inputs, const std::string &output_dir,
+              int jobs, const RenderOptions &options) {
+    std::vector<Job> work;
+    for (const std::string &input : inputs) {
+        collect_jobs(input, output_dir, work);
+    }
+    if (work.empty()) {
+        std::cerr << "Error: No input files." << std::endl;
+        return 1;
+    }
+
+    // Two inputs with the same output path (e.g. a/take.wav and b/take.wav)
+    // would have workers writing one file at once, so refuse to start
+    std::map<std::string, const Job *> outputs;
+    int duplicates = 0;
+    for (const Job &job : work) {
+        auto [it, inserted] = outputs.emplace(job.output.lexically_normal().string(), &job);
+        if (!inserted) {
+            std::cerr << "Error: " << job.input.string() << " and " << it->second->input.string()
+                      << " would both be written to " << it->first << std::endl;
+            ++duplicates;
+        }
+    }
+    if (duplicates > 0) {
+        return duplicates;
+    }
+
+    const int workers = std::max(1, std::min<int>(jobs, static_cast<int>(work.size())));
+    std::cout << "Processing " << work.size() << " files on " << workers << " threads..." << std::endl;
+
+    WorkStealingQueues queues(work.size(), workers);
+    std::atomic<int> done{0};
+    std::atomic<int> failed{0};
+    std::mutex log_mutex;
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker_main = [&](int worker) {
+        std::optional<MultichannelReverb> reverb;
+        size_t index;
+        while (queues.pop(worker, index)) {
+            const Job &job = work[index];
+            std::string error;
+            std::error_code ec;
+            fs::create_directories(job.output.parent_path(), ec);
+
+            bool ok = render_file(job.input.string(), job.output.string(), options, reverb, nullptr, error);
+
+            int n = ++done;
+            if (!ok) {
+                ++failed;
+            }
+            std::lock_guard<std::mutex> lock(log_mutex);
+            if (ok) {
+                std::cout << "[" << n << "/" << work.size() << "] " << job.output.string() << std::endl;
+            } else {
+                std::cerr << "[" << n << "/" << work.size() << "] Error: " << error << std::endl;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; ++i) {
+        threads.emplace_back(worker_main, i);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Processed " << work.size() - failed << " of " << work.size() << " files in "
+              << elapsed.count() << " s" << std::endl;
+    return failed;
+}
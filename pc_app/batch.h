@@ -0,0 +1,19 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+
+#include "render.h"
+
+// Renders every WAV file named by `inputs` into `output_dir`. An input may be
+// a file, a directory (searched recursively for *.wav, keeping the relative
+// layout) or "@list.txt" with one path per line. Files are spread over `jobs`
+// worker threads, each owning a MultichannelReverb reused across its files;
+// idle workers steal from the others' queues. Inputs that would be written
+// to the same output path are reported and nothing is rendered. Returns the
+// number of files that failed.
+int run_batch(const std::vector<std::string> &inputs, const std::string &output_dir,
+              int jobs, const RenderOptions &options);
+
+#endif // BATCH_H
@@ -0,0 +1,213 @@
+// Throughput benchmark for the float Reverb and the host builds of the
+// firmware Q15 effects. Every kernel is run over each block size and sample
+// rate, and one line of CSV (or one JSON object) is printed per case.
+//
+// A "sample" here is one stereo frame, matching how fx_process and
+// Reverb::process count their length argument.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fx.h"
+#include "reverb.h"
+
+namespace {
+    struct Kernel {
+        const char *name;
+        // Prepares a fresh instance for the sample rate
+        std::function<void(int sample_rate)> init;
+        // Processes `frames` interleaved stereo frames
+        std::function<void(int frames)> process;
+    };
+
+    struct Result {
+        std::string kernel;
+        int sample_rate;
+        int block_frames;
+        uint64_t frames;
+        double seconds;
+        double ns_per_sample;
+        double samples_per_sec;
+        double realtime_factor;
+    };
+
+    std::vector<int> parse_list(const char *arg) {
+        std::vector<int> values;
+        for (const char *p = arg; *p;) {
+            values.push_back(std::atoi(p));
+            const char *comma = std::strchr(p, ',');
+            if (!comma) {
+                break;
+            }
+            p = comma + 1;
+        }
+        return values;
+    }
+
+    void print_usage(const char *program) {
+        std::fprintf(stderr,
+                     "Usage: %s [--json] [--seconds <audio seconds per case>]\n"
+                     "          [--blocks 1,16,48,256,4096] [--rates 44100,48000,96000]\n",
+                     program);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool json = false;
+    double audio_seconds = 2.0;
+    std::vector<int> blocks = {1, 16, 48, 256, 4096};
+    std::vector<int> rates = {44100, 48000, 96000};
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            audio_seconds = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--blocks") == 0 && i + 1 < argc) {
+            blocks = parse_list(argv[++i]);
+        } else if (std::strcmp(argv[i], "--rates") == 0 && i + 1 < argc) {
+            rates = parse_list(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    const int max_block = *std::max_element(blocks.begin(), blocks.end());
+
+    // Deterministic white noise at about -12 dBFS
+    std::vector<float> input_f(2 * max_block);
+    std::vector<int32_t> input_q(2 * max_block);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < input_f.size(); ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        int32_t v = static_cast<int32_t>(seed) >> 2;
+        input_q[i] = v;
+        input_f[i] = v / 2147483648.0f;
+    }
+    std::vector<float> silence_f(2 * max_block, 0.0f);
+    std::vector<float> buffer_f(2 * max_block);
+    std::vector<int32_t> buffer_q(2 * max_block);
+
+    std::unique_ptr<Reverb> reverb;
+    std::unique_ptr<BasicReverb<Schroeder4x2>> small_reverb;
+
+    // The Q15 effects run through the firmware chain, as they do on the device
+    auto init_program = [](uint8_t program, int sr) {
+        fx_init();
+        fx_set_format(32, static_cast<uint32_t>(sr));
+        fx_set_enable(true);
+        fx_select_program(program);
+    };
+    auto process_q15 = [&](int frames) {
+        std::memcpy(buffer_q.data(), input_q.data(), 2 * frames * sizeof(int32_t));
+        fx_process(buffer_q.data(), buffer_q.data(), frames);
+    };
+
+    const Kernel kernels[] = {
+        {"reverb_lib",
+         [&](int sr) {
+             reverb = std::make_unique<Reverb>(static_cast<float>(sr));
+             reverb->set_simd(true);
+         },
+         [&](int frames) { reverb->process_interleaved(input_f.data(), buffer_f.data(), frames); }},
+        {"reverb_lib_scalar",
+         [&](int sr) {
+             reverb = std::make_unique<Reverb>(static_cast<float>(sr));
+             reverb->set_simd(false);
+         },
+         [&](int frames) { reverb->process_interleaved(input_f.data(), buffer_f.data(), frames); }},
+        {"reverb_lib_4x2",
+         [&](int sr) { small_reverb = std::make_unique<BasicReverb<Schroeder4x2>>(static_cast<float>(sr)); },
+         [&](int frames) { small_reverb->process_interleaved(input_f.data(), buffer_f.data(), frames); }},
+        // Steady-state freeze; the warm-up runs past the freeze ramp
+        {"reverb_lib_frozen",
+         [&](int sr) {
+             reverb = std::make_unique<Reverb>(static_cast<float>(sr));
+             reverb->set_freeze(true);
+         },
+         [&](int frames) { reverb->process_interleaved(input_f.data(), buffer_f.data(), frames); }},
+        // A burst, then silence: the tail decays and the network goes to sleep
+        {"reverb_lib_silence",
+         [&](int sr) {
+             reverb = std::make_unique<Reverb>(static_cast<float>(sr));
+             reverb->process_interleaved(input_f.data(), buffer_f.data(), max_block);
+         },
+         [&](int frames) { reverb->process_interleaved(silence_f.data(), buffer_f.data(), frames); }},
+        {"fx_reverb_q15", [&](int sr) { init_program(0, sr); }, process_q15},
+        {"fx_granular_q15", [&](int sr) { init_program(1, sr); }, process_q15},
+        {"fx_chain_q15", [&](int sr) { init_program(2, sr); }, process_q15},
+        {"fx_reverb_q31", [&](int sr) { init_program(3, sr); }, process_q15},
+    };
+
+    using clock = std::chrono::steady_clock;
+    std::vector<Result> results;
+
+    for (const Kernel &kernel : kernels) {
+        for (int sr : rates) {
+            for (int block : blocks) {
+                if (block <= 0 || sr <= 0) {
+                    continue;
+                }
+                kernel.init(sr);
+
+                // Warm up caches and let the tails build before timing
+                const uint64_t warmup = sr / 10;
+                for (uint64_t done = 0; done < warmup; done += block) {
+                    kernel.process(block);
+                }
+
+                const uint64_t total = static_cast<uint64_t>(audio_seconds * sr);
+                uint64_t frames = 0;
+                auto start = clock::now();
+                while (frames < total) {
+                    kernel.process(block);
+                    frames += block;
+                }
+                std::chrono::duration<double> elapsed = clock::now() - start;
+
+                Result r;
+                r.kernel = kernel.name;
+                r.sample_rate = sr;
+                r.block_frames = block;
+                r.frames = frames;
+                r.seconds = elapsed.count();
+                r.ns_per_sample = 1e9 * r.seconds / frames;
+                r.samples_per_sec = frames / r.seconds;
+                r.realtime_factor = r.samples_per_sec / sr;
+                results.push_back(r);
+            }
+        }
+    }
+
+    if (json) {
+        std::printf("{\"simd\": \"%s\", \"results\": [\n", Reverb(48000.0f).simd_name());
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result &r = results[i];
+            std::printf("  {\"kernel\": \"%s\", \"sample_rate\": %d, \"block_frames\": %d, "
+                        "\"frames\": %llu, \"seconds\": %.6f, \"ns_per_sample\": %.3f, "
+                        "\"samples_per_sec\": %.0f, \"realtime_factor\": %.2f}%s\n",
+                        r.kernel.c_str(), r.sample_rate, r.block_frames,
+                        static_cast<unsigned long long>(r.frames), r.seconds, r.ns_per_sample,
+                        r.samples_per_sec, r.realtime_factor, (i + 1 < results.size()) ? "," : "");
+        }
+        std::printf("]}\n");
+    } else {
+        std::printf("kernel,sample_rate,block_frames,frames,seconds,ns_per_sample,samples_per_sec,realtime_factor\n");
+        for (const Result &r : results) {
+            std::printf("%s,%d,%d,%llu,%.6f,%.3f,%.0f,%.2f\n", r.kernel.c_str(), r.sample_rate,
+                        r.block_frames, static_cast<unsigned long long>(r.frames), r.seconds,
+                        r.ns_per_sample, r.samples_per_sec, r.realtime_factor);
+        }
+    }
+
+    return 0;
+}
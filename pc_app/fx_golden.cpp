@@ -0,0 +1,253 @@
+// Golden-output regression harness for the firmware Q15 effects.
+//
+// Each effect is run over a fixed corpus of test signals and its int32
+// output is compared sample by sample with the files in pc_app/golden.
+// Rewrites of the DSP code must stay bit-exact unless a tolerance is given
+// with --max-error. Pass --record after an intentional change in sound to
+// regenerate the files.
+//
+// Files are "FXG1", frame count (u32 LE), channel count (u32 LE) followed by
+// the interleaved int32 LE samples.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "fx.h"
+
+namespace {
+    const int SAMPLE_RATE = 48000;
+    const int NUM_FRAMES = 12000;
+    const int NUM_CHANNELS = 2;
+    const double PI = 3.14159265358979323846;
+
+    // Irregular block sizes so block-boundary handling is covered too
+    const int BLOCK_PATTERN[] = {48, 1, 37, 64, 200, 5, 48, 96};
+
+    struct Effect {
+        const char *name;
+        const fx_t *fx;
+    };
+
+    const Effect EFFECTS[] = {
+        {"reverb", &fx_reverb},
+        {"reverb_q31", &fx_reverb_q31},
+        {"granular", &fx_granular},
+    };
+
+    // A test signal plus the frame at which fx_set_enable flips from
+    // `enable_before` to its inverse (or never, when negative).
+    struct Case {
+        const char *name;
+        void (*generate)(std::vector<float> &left, std::vector<float> &right);
+        bool enable_before;
+        int toggle_frame;
+    };
+
+    uint32_t noise_state;
+    float noise() {
+        noise_state ^= noise_state << 13;
+        noise_state ^= noise_state >> 17;
+        noise_state ^= noise_state << 5;
+        return static_cast<int32_t>(noise_state) / 2147483648.0f;
+    }
+
+    void gen_impulse(std::vector<float> &l, std::vector<float> &r) {
+        l[0] = 0.5f;
+        r[0] = -0.5f;
+    }
+
+    void gen_sweep(std::vector<float> &l, std::vector<float> &r) {
+        // Exponential sine sweep 20 Hz - 20 kHz at -6 dBFS
+        const double f0 = 20.0, f1 = 20000.0, T = double(NUM_FRAMES) / SAMPLE_RATE;
+        const double k = std::log(f1 / f0);
+        for (int i = 0; i < NUM_FRAMES; ++i) {
+            double t = double(i) / SAMPLE_RATE;
+            double phase = 2.0 * PI * f0 * T / k * (std::exp(t / T * k) - 1.0);
+            l[i] = static_cast<float>(0.5 * std::sin(phase));
+            r[i] = static_cast<float>(0.5 * std::cos(phase));
+        }
+    }
+
+    void gen_noise(std::vector<float> &l, std::vector<float> &r) {
+        noise_state = 0x12345678u;
+        for (int i = 0; i < NUM_FRAMES; ++i) {
+            l[i] = 0.25f * noise();
+            r[i] = 0.25f * noise();
+        }
+    }
+
+    void gen_burst(std::vector<float> &l, std::vector<float> &r) {
+        noise_state = 0x0badf00du;
+        for (int i = 0; i < 2000; ++i) {
+            l[i] = 0.5f * noise();
+            r[i] = 0.5f * noise();
+        }
+    }
+
+    const Case CASES[] = {
+        {"impulse", gen_impulse, true, -1},
+        {"sweep", gen_sweep, true, -1},
+        {"noise", gen_noise, true, -1},
+        {"burst_tail", gen_burst, true, -1},
+        // Noise with the effect off, then silence with it switched on
+        // (for the granular effect this freezes the recorded buffer)
+        {"silence_freeze", gen_burst, false, 2000},
+    };
+
+    std::vector<int32_t> render(const fx_t &fx, const Case &c) {
+        std::vector<float> left(NUM_FRAMES, 0.0f), right(NUM_FRAMES, 0.0f);
+        c.generate(left, right);
+
+        // 24-bit samples, MSB-aligned in 32 bits as they arrive over USB
+        std::vector<int32_t> audio(NUM_CHANNELS * NUM_FRAMES);
+        for (int i = 0; i < NUM_FRAMES; ++i) {
+            audio[2 * i] = static_cast<int32_t>(std::lrint(left[i] * 8388607.0f)) * 256;
+            audio[2 * i + 1] = static_cast<int32_t>(std::lrint(right[i] * 8388607.0f)) * 256;
+        }
+
+        fx.init();
+        fx.set_format(32, SAMPLE_RATE);
+        fx.set_enable(c.enable_before);
+
+        size_t pos = 0;
+        size_t pattern = 0;
+        while (pos < static_cast<size_t>(NUM_FRAMES)) {
+            size_t n = BLOCK_PATTERN[pattern++ % (sizeof(BLOCK_PATTERN) / sizeof(BLOCK_PATTERN[0]))];
+            if (c.toggle_frame >= 0 && pos < static_cast<size_t>(c.toggle_frame)) {
+                n = std::min<size_t>(n, c.toggle_frame - pos);
+            }
+            n = std::min<size_t>(n, NUM_FRAMES - pos);
+            if (c.toggle_frame >= 0 && pos == static_cast<size_t>(c.toggle_frame)) {
+                fx.set_enable(!c.enable_before);
+            }
+            int32_t *block = audio.data() + NUM_CHANNELS * pos;
+            fx.process(block, block, n);
+            pos += n;
+        }
+        return audio;
+    }
+
+    void put_u32(FILE *f, uint32_t v) {
+        uint8_t b[4] = {uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24)};
+        std::fwrite(b, 1, 4, f);
+    }
+
+    bool get_u32(FILE *f, uint32_t *v) {
+        uint8_t b[4];
+        if (std::fread(b, 1, 4, f) != 4) {
+            return false;
+        }
+        *v = uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+        return true;
+    }
+
+    bool write_golden(const std::string &path, const std::vector<int32_t> &data) {
+        FILE *f = std::fopen(path.c_str(), "wb");
+        if (!f) {
+            return false;
+        }
+        std::fwrite("FXG1", 1, 4, f);
+        put_u32(f, NUM_FRAMES);
+        put_u32(f, NUM_CHANNELS);
+        for (int32_t v : data) {
+            put_u32(f, static_cast<uint32_t>(v));
+        }
+        return std::fclose(f) == 0;
+    }
+
+    bool read_golden(const std::string &path, std::vector<int32_t> &data) {
+        FILE *f = std::fopen(path.c_str(), "rb");
+        if (!f) {
+            return false;
+        }
+        char magic[4];
+        uint32_t frames = 0, channels = 0;
+        bool ok = std::fread(magic, 1, 4, f) == 4 && std::memcmp(magic, "FXG1", 4) == 0 &&
+                  get_u32(f, &frames) && get_u32(f, &channels);
+        data.resize(size_t(frames) * channels);
+        for (size_t i = 0; ok && i < data.size(); ++i) {
+            uint32_t v = 0;
+            ok = get_u32(f, &v);
+            data[i] = static_cast<int32_t>(v);
+        }
+        std::fclose(f);
+        return ok;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool record = false;
+    int64_t max_error = 0;
+    const char *dir = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--record") == 0) {
+            record = true;
+        } else if (std::strcmp(argv[i], "--max-error") == 0 && i + 1 < argc) {
+            max_error = std::atoll(argv[++i]);
+        } else if (!dir) {
+            dir = argv[i];
+        } else {
+            dir = nullptr;
+            break;
+        }
+    }
+    if (!dir) {
+        std::fprintf(stderr, "Usage: %s [--record] [--max-error <lsb>] <golden_dir>\n", argv[0]);
+        return 2;
+    }
+
+    int failures = 0;
+    for (const Effect &fx : EFFECTS) {
+        for (const Case &c : CASES) {
+            std::string path = std::string(dir) + "/" + fx.name + "_" + c.name + ".bin";
+            std::vector<int32_t> output = render(*fx.fx, c);
+
+            if (record) {
+                if (!write_golden(path, output)) {
+                    std::fprintf(stderr, "Error: could not write %s\n", path.c_str());
+                    return 2;
+                }
+                std::printf("recorded %s\n", path.c_str());
+                continue;
+            }
+
+            std::vector<int32_t> golden;
+            if (!read_golden(path, golden) || golden.size() != output.size()) {
+                std::printf("FAIL %s/%s: missing or malformed %s\n", fx.name, c.name, path.c_str());
+                ++failures;
+                continue;
+            }
+
+            // Errors are counted in 24-bit LSBs, the resolution of the stream
+            int64_t worst = 0;
+            size_t mismatches = 0, first = 0;
+            for (size_t i = 0; i < output.size(); ++i) {
+                int64_t err = (std::llabs(int64_t(output[i]) - golden[i]) + 255) / 256;
+                if (output[i] != golden[i]) {
+                    if (mismatches++ == 0) {
+                        first = i;
+                    }
+                }
+                worst = std::max(worst, err);
+            }
+
+            bool pass = (max_error == 0) ? (mismatches == 0) : (worst <= max_error);
+            if (mismatches == 0) {
+                std::printf("PASS %s/%s: bit-exact\n", fx.name, c.name);
+            } else {
+                std::printf("%s %s/%s: %zu samples differ, first at frame %zu ch %zu, max error %lld LSB\n",
+                            pass ? "PASS" : "FAIL", fx.name, c.name, mismatches, first / NUM_CHANNELS,
+                            first % NUM_CHANNELS, static_cast<long long>(worst));
+            }
+            failures += pass ? 0 : 1;
+        }
+    }
+    return failures ? 1 : 0;
+}
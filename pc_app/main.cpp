@@ -1,57 +1,70 @@
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
 #include <vector>
-#include "AudioFile.h"
-#include "reverb.h"
+#include "batch.h"
+#include "render.h"
 
-int main(int argc, char *argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <input.wav> <output.wav>" << std::endl;
-        return 1;
-    }
+static void print_usage(const char *program) {
+    std::cerr << "Usage: " << program << " [options] <input.wav> <output.wav>" << std::endl;
+    std::cerr << "       " << program << " [options] --batch <output_dir> <input.wav|dir|@list.txt>..." << std::endl;
+    std::cerr << "  --block <frames>   Frames read, processed and written per block (default 4096)" << std::endl;
+    std::cerr << "  --tail <seconds>   Let the reverb ring out past the end of the input (default 0)" << std::endl;
+    std::cerr << "  --jobs <n>         Worker threads in batch mode (default: one per core)" << std::endl;
+    std::cerr << "  --threads <n>      Threads sharing the channel pairs of a multichannel file (default 1)" << std::endl;
+    std::cerr << "  Use - as the input or output path to read stdin or write stdout." << std::endl;
+}
 
-    const char* inputFilePath = argv[1];
-    const char* outputFilePath = argv[2];
+int main(int argc, char *argv[]) {
+    RenderOptions options;
+    int jobs = static_cast<int>(std::thread::hardware_concurrency());
+    const char *batchDir = nullptr;
+    std::vector<std::string> paths;
 
-    AudioFile<float> audioFile;
-    if (!audioFile.load(inputFilePath)) {
-        std::cerr << "Error: Could not load input file " << inputFilePath << std::endl;
-        return 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--block") == 0 && i + 1 < argc) {
+            options.block_frames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--tail") == 0 && i + 1 < argc) {
+            options.tail_seconds = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batchDir = argv[++i];
+        } else {
+            paths.push_back(argv[i]);
+        }
     }
 
-    int sampleRate = audioFile.getSampleRate();
-    int numChannels = audioFile.getNumChannels();
-
-    std::cout << "Input file loaded successfully." << std::endl;
-    std::cout << "Sample Rate: " << sampleRate << std::endl;
-    std::cout << "Channels: " << numChannels << std::endl;
-
-    if (numChannels < 1 || numChannels > 2) {
-        std::cerr << "Error: This application currently only supports mono or stereo WAV files." << std::endl;
+    bool valid = options.block_frames > 0 && options.tail_seconds >= 0.0 && options.threads > 0;
+    valid = valid && (batchDir ? !paths.empty() : paths.size() == 2);
+    if (!valid) {
+        print_usage(argv[0]);
         return 1;
     }
 
-    // If mono, duplicate the channel
-    if (numChannels == 1) {
-        audioFile.samples.push_back(audioFile.samples[0]);
-        audioFile.setNumChannels(2);
-        std::cout << "Mono file detected. Duplicating channel to create stereo." << std::endl;
+    if (batchDir) {
+        return run_batch(paths, batchDir, jobs > 0 ? jobs : 1, options) == 0 ? 0 : 1;
     }
 
-    Reverb reverb(static_cast<float>(sampleRate));
-
-    // Get the audio buffers
-    std::vector<float>& leftChannel = audioFile.samples[0];
-    std::vector<float>& rightChannel = audioFile.samples[1];
+    const std::string &inputFilePath = paths[0];
+    const std::string &outputFilePath = paths[1];
 
-    std::cout << "Applying reverb..." << std::endl;
-    reverb.process(leftChannel.data(), rightChannel.data(), audioFile.getNumSamplesPerChannel());
+    // Keep stdout clean for the audio stream when writing to a pipe
+    std::ostream &log = (outputFilePath == "-") ? std::cerr : std::cout;
 
-    if (!audioFile.save(outputFilePath)) {
-        std::cerr << "Error: Could not save output file " << outputFilePath << std::endl;
+    std::optional<MultichannelReverb> reverb;
+    std::string error;
+    if (!render_file(inputFilePath, outputFilePath, options, reverb, &log, error)) {
+        std::cerr << "Error: " << error << std::endl;
         return 1;
     }
 
-    std::cout << "Reverb applied and output file saved successfully to " << outputFilePath << std::endl;
+    log << "Reverb applied and output file saved successfully to " << outputFilePath << std::endl;
 
     return 0;
 }
@@ -0,0 +1,200 @@
+#include "render.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "wav_stream.h"
+
+namespace {
+    struct Block {
+        std::vector<std::vector<float>> samples;  // one buffer per channel
+        std::vector<float *> channels;
+        size_t frames = 0;
+    };
+
+    // Single-producer / single-consumer queue of decoded blocks. The helper
+    // thread fills free slots while the caller processes the oldest one; a
+    // block with zero frames marks the end of the input.
+    class ReadAhead {
+    public:
+        // Blocks have `num_channels` buffers, at least as many as the file
+        ReadAhead(WavReader &reader, int block_frames, int num_channels)
+            : reader_(reader), block_frames_(block_frames) {
+            for (Block &block : blocks_) {
+                block.samples.assign(num_channels, std::vector<float>(block_frames));
+                for (std::vector<float> &samples : block.samples) {
+                    block.channels.push_back(samples.data());
+                }
+            }
+            thread_ = std::thread(&ReadAhead::run, this);
+        }
+
+        ~ReadAhead() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            cv_.notify_all();
+            thread_.join();
+        }
+
+        Block &front() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return count_ > 0; });
+            return blocks_[head_];
+        }
+
+        void pop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                head_ = (head_ + 1) % DEPTH;
+                --count_;
+            }
+            cv_.notify_all();
+        }
+
+    private:
+        static constexpr size_t DEPTH = 4;
+
+        void run() {
+            size_t tail = 0;
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cv_.wait(lock, [this] { return stop_ || count_ < DEPTH; });
+                    if (stop_) {
+                        return;
+                    }
+                }
+
+                // The slot at `tail` is not visible to the consumer until count_ is bumped
+                Block &block = blocks_[tail];
+                block.frames = reader_.read(block.channels.data(), block_frames_);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    ++count_;
+                }
+                cv_.notify_all();
+
+                if (block.frames == 0) {
+                    return;
+                }
+                tail = (tail + 1) % DEPTH;
+            }
+        }
+
+        WavReader &reader_;
+        size_t block_frames_;
+        Block blocks_[DEPTH];
+        size_t head_ = 0;
+        size_t count_ = 0;
+        bool stop_ = false;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::thread thread_;
+    };
+}
+
+bool render_file(const std::string &input_path, const std::string &output_path,
+                 const RenderOptions &options, std::optional<MultichannelReverb> &reverb,
+                 std::ostream *log, std::string &error) {
+    WavReader reader;
+    if (!reader.open(input_path.c_str())) {
+        error = "Could not load input file " + input_path + ": " + reader.error();
+        return false;
+    }
+
+    WavFormat format = reader.format();
+    int sampleRate = format.sample_rate;
+    int numChannels = format.num_channels;
+
+    if (log) {
+        *log << "Input file opened successfully." << std::endl;
+        *log << "Sample Rate: " << sampleRate << std::endl;
+        *log << "Channels: " << numChannels << std::endl;
+    }
+
+    // If mono, duplicate the channel
+    if (numChannels == 1) {
+        if (log) {
+            *log << "Mono file detected. Duplicating channel to create stereo." << std::endl;
+        }
+        format.num_channels = 2;
+        format.channel_mask = 0;
+    }
+    const int outChannels = format.num_channels;
+
+    WavWriter writer;
+    if (!writer.open(output_path.c_str(), format)) {
+        error = "Could not save output file " + output_path + ": " + writer.error();
+        return false;
+    }
+
+    // A reverb kept from the previous file keeps its delay pools
+    if (reverb) {
+        reverb->configure(outChannels, static_cast<float>(sampleRate));
+    } else {
+        reverb.emplace(outChannels, static_cast<float>(sampleRate), options.threads);
+    }
+
+    if (log) {
+        *log << "Applying reverb..." << std::endl;
+    }
+
+    // Stream the input through the reverb one block at a time
+    {
+        ReadAhead input(reader, options.block_frames, outChannels);
+        for (;;) {
+            Block &block = input.front();
+            if (block.frames == 0) {
+                break;
+            }
+            if (numChannels == 1) {
+                std::copy(block.samples[0].begin(), block.samples[0].begin() + block.frames,
+                          block.samples[1].begin());
+            }
+            reverb->process(block.channels.data(), static_cast<int>(block.frames));
+
+            if (!writer.write(block.channels.data(), block.frames)) {
+                error = "Could not save output file " + output_path + ": " + writer.error();
+                return false;
+            }
+            input.pop();
+        }
+    }
+    if (!reader.error().empty()) {
+        error = "Could not read input file " + input_path + ": " + reader.error();
+        return false;
+    }
+
+    // Feed silence so the tail rings out after the input ends
+    std::vector<std::vector<float>> tail(outChannels, std::vector<float>(options.block_frames));
+    std::vector<float *> channels;
+    for (std::vector<float> &samples : tail) {
+        channels.push_back(samples.data());
+    }
+
+    uint64_t tailFrames = static_cast<uint64_t>(options.tail_seconds * sampleRate);
+    while (tailFrames > 0) {
+        size_t frames = static_cast<size_t>(std::min<uint64_t>(tailFrames, options.block_frames));
+        for (std::vector<float> &samples : tail) {
+            std::fill(samples.begin(), samples.begin() + frames, 0.0f);
+        }
+        reverb->process(channels.data(), static_cast<int>(frames));
+        if (!writer.write(channels.data(), frames)) {
+            error = "Could not save output file " + output_path + ": " + writer.error();
+            return false;
+        }
+        tailFrames -= frames;
+    }
+
+    if (!writer.close()) {
+        error = "Could not save output file " + output_path + ": " + writer.error();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <optional>
+#include <ostream>
+#include <string>
+
+#include "multichannel_reverb.h"
+
+struct RenderOptions {
+    int block_frames = 4096;    // frames read, processed and written per block
+    double tail_seconds = 0.0;  // silence fed after the input so the tail rings out
+    int threads = 1;            // threads sharing the channel pairs of one file
+};
+
+// Streams one WAV file through the reverb. The input is decoded on a helper
+// thread a few blocks ahead of the DSP so file reads overlap with processing.
+// Every channel of the file is processed, mono being duplicated to stereo;
+// surround and ambisonic files keep their channel layout. `reverb` is built
+// on first use and afterwards reconfigured for the file's channels and
+// sample rate, reusing its delay pools, which lets a caller keep one
+// instance per thread across many files. Progress goes to `log` when it is not null; on
+// failure the reason is stored in `error`.
+bool render_file(const std::string &input_path, const std::string &output_path,
+                 const RenderOptions &options, std::optional<MultichannelReverb> &reverb,
+                 std::ostream *log, std::string &error);
+
+#endif // RENDER_H
@@ -0,0 +1,124 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include "check.h"
+#include "latency.h"
+
+// Built twice: with AUDIO_USE_FEEDBACK_EP the host follows the explicit
+// feedback, without it the IN packet sizes alone absorb the drift.
+
+namespace {
+    const int NUM_FRAMES = 30000;  // USB frames, 30 s
+    const int SETTLED = 20000;
+
+    struct Result {
+        double feedback;  // mean feedback over the settled part, frames per USB frame
+        long min_fill;
+        long max_fill;
+        long min_packet;  // IN packet sizes over the whole run
+        long max_packet;
+        uint32_t underruns;
+    };
+
+    // With feedback, a host sending OUT packets at the rate the device last
+    // fed back, and a device whose crystal is `ppm` off the host's. Without
+    // it, a host whose audio clock is `ppm` off its SOFs, so the OUT stream
+    // drifts against the IN packets the device paces. Either way the device
+    // runs 48-frame blocks and sends IN packets as the firmware does.
+    Result run(uint32_t sample_rate, double ppm) {
+        latency_init(sample_rate);
+        const uint32_t underruns = latency_get_stats()->underruns;
+        const int block = 48;
+#if AUDIO_USE_FEEDBACK_EP
+        uint32_t feedback = (sample_rate << 16) / 1000;
+        double now_us = 0.0;
+#endif
+        double host_phase = 0.0;
+        long rx = 0;
+        // Start at the target depth, as a stream that has been running would
+        long tx = static_cast<long>(latency_get_stats()->target_frames);
+        Result r = {0.0, 1L << 30, 0, 1L << 30, 0, 0};
+        for (int f = 0; f < NUM_FRAMES; ++f) {
+#if AUDIO_USE_FEEDBACK_EP
+            now_us += 1000.0 * (1.0 + ppm * 1e-6);
+            host_phase += feedback / 65536.0;
+#else
+            host_phase += sample_rate / 1000.0 * (1.0 + ppm * 1e-6);
+#endif
+            const long received = static_cast<long>(host_phase);
+            host_phase -= received;
+            rx += received;
+            for (; rx >= block; rx -= block) {
+                tx += block;
+            }
+
+            // A packet one frame short is a rate slip, anything shorter an
+            // underrun, as in tud_audio_tx_done_pre_load_cb
+            const long frames = latency_next_packet_frames(static_cast<size_t>(rx + tx));
+            const long sent = (frames < tx) ? frames : tx;
+            if (sent + 1 < frames)
+                latency_count_underrun();
+            tx -= sent;
+            if (frames < r.min_packet)
+                r.min_packet = frames;
+            if (frames > r.max_packet)
+                r.max_packet = frames;
+
+#if AUDIO_USE_FEEDBACK_EP
+            feedback = latency_feedback_q16(static_cast<uint32_t>(f), static_cast<uint32_t>(now_us),
+                                            static_cast<size_t>(rx + tx));
+#endif
+            if (f >= SETTLED) {
+#if AUDIO_USE_FEEDBACK_EP
+                r.feedback += feedback / 65536.0 / (NUM_FRAMES - SETTLED);
+#endif
+                if (rx + tx < r.min_fill)
+                    r.min_fill = rx + tx;
+                if (rx + tx > r.max_fill)
+                    r.max_fill = rx + tx;
+            }
+        }
+        r.underruns = latency_get_stats()->underruns - underruns;
+        return r;
+    }
+}
+
+int main() {
+    const double ppms[] = {150.0, -200.0, 0.0};
+    const uint32_t rates[] = {44100, 48000};
+    for (uint32_t rate : rates) {
+        for (double ppm : ppms) {
+            const Result r = run(rate, ppm);
+            const double expected = rate / 1000.0 * (1.0 + ppm * 1e-6);
+            const long target = static_cast<long>(latency_get_stats()->target_frames);
+            std::printf("%u Hz, %+.0f ppm: ", rate, ppm);
+#if AUDIO_USE_FEEDBACK_EP
+            std::printf("feedback %.5f (device %.5f), ", r.feedback, expected);
+#endif
+            std::printf("fill %ld..%ld, target %ld, packets %ld..%ld, underruns %u\n", r.min_fill,
+                        r.max_fill, target, r.min_packet, r.max_packet, r.underruns);
+
+#if AUDIO_USE_FEEDBACK_EP
+            // The feedback follows the device clock, not the nominal rate,
+            // to within 10 ppm
+            CHECK(std::fabs(r.feedback - expected) < expected * 10e-6);
+#endif
+            // The buffers stay within a block of the target depth,
+            CHECK(r.min_fill >= target - 48 && r.max_fill <= target + 48);
+            // packets slip at most one frame from the nominal size
+            const long nominal_min = static_cast<long>(rate / 1000);
+            const long nominal_max = static_cast<long>((rate + 999) / 1000);
+            CHECK(r.min_packet >= nominal_min - 1 && r.max_packet <= nominal_max + 1);
+            // and the IN stream never runs dry
+            CHECK(r.underruns == 0);
+        }
+    }
+
+#if AUDIO_USE_FEEDBACK_EP
+    std::printf("Test passed: latency feedback.\n");
+#else
+    std::printf("Test passed: adaptive latency.\n");
+#endif
+    return 0;
+}
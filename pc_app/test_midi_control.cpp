@@ -0,0 +1,86 @@
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include "check.h"
+#include "fx.h"
+#include "midi_control.h"
+
+namespace {
+    const int SAMPLE_RATE = 48000;
+    const int BLOCK_FRAMES = 48;
+    const int NUM_BLOCKS = 100;
+
+    // Runs the reverb program over a fixed noise signal. `control` is called
+    // before the first block, after the mix has been put back to its default.
+    std::vector<int32_t> render(const std::function<void()> &control) {
+        fx_init();
+        fx_set_format(32, SAMPLE_RATE);
+        fx_set_enable(true);
+        fx_set_param(FX_PARAM_WET_MIX, midi_nrpn_to_q15(8192));
+        fx_set_param(FX_PARAM_DRY_MIX, midi_nrpn_to_q15(8192));
+        control();
+
+        std::vector<int32_t> out(2 * BLOCK_FRAMES * NUM_BLOCKS);
+        uint32_t seed = 1;
+        for (size_t i = 0; i < out.size(); ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            out[i] = static_cast<int32_t>(seed) >> 3;
+        }
+        for (int b = 0; b < NUM_BLOCKS; ++b) {
+            int32_t *block = &out[2 * BLOCK_FRAMES * b];
+            fx_process(block, block, BLOCK_FRAMES);
+        }
+        return out;
+    }
+
+    void nrpn(uint8_t param, uint16_t value) {
+        midi_control_change(99, 0);
+        midi_control_change(98, param);
+        midi_control_change(6, value >> 7);
+        midi_control_change(38, value & 0x7F);
+    }
+}
+
+int main() {
+    // The table matches the float conversion it replaces
+    for (int v = 0; v < 128; ++v) {
+        CHECK(midi_cc_to_q15(static_cast<uint8_t>(v)) ==
+               static_cast<int16_t>(v / 127.0f * 32767.f + 0.5f));
+    }
+
+    // 14-bit values cover the full Q15 range in order
+    CHECK(midi_nrpn_to_q15(0) == 0 && midi_nrpn_to_q15(16383) == 32767);
+    for (uint16_t v = 1; v < 16384; ++v) {
+        CHECK(midi_nrpn_to_q15(v) > midi_nrpn_to_q15(v - 1));
+    }
+
+    const std::vector<int32_t> neutral = render([] {});
+    const std::vector<int32_t> wet20 = render([] { fx_set_param(FX_PARAM_WET_MIX, midi_cc_to_q15(20)); });
+    CHECK(wet20 != neutral);
+
+    // A CC maps to its parameter, and a burst of them before a block leaves
+    // only the last value
+    CHECK(render([] { midi_control_change(FX_PARAM_WET_MIX, 20); }) == wet20);
+    CHECK(render([] {
+               for (int v = 0; v < 128; ++v) {
+                   midi_control_change(FX_PARAM_WET_MIX, static_cast<uint8_t>(v));
+               }
+               midi_control_change(FX_PARAM_WET_MIX, 20);
+           }) == wet20);
+
+    // Full-scale NRPN equals full-scale CC
+    const std::vector<int32_t> wet_full = render([] { midi_control_change(FX_PARAM_WET_MIX, 127); });
+    CHECK(render([] { nrpn(FX_PARAM_WET_MIX, 16383); }) == wet_full);
+
+    // Data entry without a selected NRPN changes nothing
+    CHECK(render([] {
+               midi_control_change(101, 0);
+               midi_control_change(100, 0);
+               midi_control_change(6, 127);
+           }) == neutral);
+
+    std::printf("Test passed: MIDI control.\n");
+    return 0;
+}
@@ -0,0 +1,374 @@
+#include "wav_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace {
+    constexpr uint16_t FORMAT_PCM = 0x0001;
+    constexpr uint16_t FORMAT_FLOAT = 0x0003;
+    constexpr uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+    constexpr uint32_t UNKNOWN_SIZE = 0xFFFFFFFF;
+    constexpr size_t IO_BUFFER_BYTES = 1 << 18;
+
+    uint16_t get_u16(const uint8_t *p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t get_u32(const uint8_t *p) {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    void put_u16(uint8_t *p, uint16_t v) {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    void put_u32(uint8_t *p, uint32_t v) {
+        for (int i = 0; i < 4; ++i) {
+            p[i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+    }
+
+    std::FILE *open_stream(const char *path, const char *mode, std::FILE *std_stream, bool *owns) {
+        if (std::strcmp(path, "-") == 0) {
+#ifdef _WIN32
+            _setmode(_fileno(std_stream), _O_BINARY);
+#endif
+            *owns = false;
+            return std_stream;
+        }
+        *owns = true;
+        return std::fopen(path, mode);
+    }
+
+    // Same symmetric scaling as AudioFile, so streamed output matches what
+    // whole-file processing produced.
+    float decode_sample(const uint8_t *p, const WavFormat &format) {
+        switch (format.bits_per_sample) {
+        case 8:
+            return (static_cast<int>(p[0]) - 128) / 127.0f;
+        case 16:
+            return static_cast<int16_t>(get_u16(p)) / 32767.0f;
+        case 24: {
+            int32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+            v = (v ^ 0x800000) - 0x800000;  // sign-extend
+            return static_cast<float>(v) / 8388607.0f;
+        }
+        default:
+            if (format.is_float) {
+                float f;
+                uint32_t bits = get_u32(p);
+                std::memcpy(&f, &bits, sizeof(f));
+                return f;
+            }
+            return static_cast<float>(static_cast<int32_t>(get_u32(p))) / 2147483647.0f;
+        }
+    }
+
+    void encode_sample(uint8_t *p, float x, const WavFormat &format) {
+        if (format.is_float) {
+            uint32_t bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+            put_u32(p, bits);
+            return;
+        }
+        switch (format.bits_per_sample) {
+        case 8:
+            x = std::min(1.0f, std::max(-1.0f, x));
+            p[0] = static_cast<uint8_t>(1 + (x + 1.0f) / 2.0f * 254);
+            break;
+        case 16:
+            x = std::min(1.0f, std::max(-1.0f, x));
+            put_u16(p, static_cast<uint16_t>(static_cast<int16_t>(x * 32767.0f)));
+            break;
+        case 24: {
+            x = std::min(1.0f, std::max(-1.0f, x));
+            uint32_t v = static_cast<uint32_t>(static_cast<int32_t>(x * 8388607.0f));
+            p[0] = static_cast<uint8_t>(v);
+            p[1] = static_cast<uint8_t>(v >> 8);
+            p[2] = static_cast<uint8_t>(v >> 16);
+            break;
+        }
+        default:
+            int32_t v;
+            if (x >= 1.0f) {
+                v = INT32_MAX;
+            } else if (x <= -1.0f) {
+                v = -INT32_MAX;
+            } else {
+                v = static_cast<int32_t>(x * 2147483647.0f);
+            }
+            put_u32(p, static_cast<uint32_t>(v));
+            break;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// WavReader
+
+WavReader::~WavReader() {
+    close();
+}
+
+bool WavReader::fail(const std::string &message) {
+    error_ = message;
+    close();
+    return false;
+}
+
+bool WavReader::read_bytes(void *dst, size_t n) {
+    return std::fread(dst, 1, n, file_) == n;
+}
+
+bool WavReader::skip_bytes(uint64_t n) {
+    // Pipes cannot seek, so skip unknown chunks by reading through them
+    uint8_t scratch[512];
+    while (n > 0) {
+        size_t step = static_cast<size_t>(std::min<uint64_t>(n, sizeof(scratch)));
+        if (!read_bytes(scratch, step)) {
+            return false;
+        }
+        n -= step;
+    }
+    return true;
+}
+
+bool WavReader::open(const char *path) {
+    close();
+    error_.clear();
+
+    file_ = open_stream(path, "rb", stdin, &owns_file_);
+    if (!file_) {
+        return fail(std::string("cannot open ") + path);
+    }
+    std::setvbuf(file_, nullptr, _IOFBF, IO_BUFFER_BYTES);
+
+    uint8_t riff[12];
+    if (!read_bytes(riff, sizeof(riff)) || std::memcmp(riff, "RIFF", 4) != 0 ||
+        std::memcmp(riff + 8, "WAVE", 4) != 0) {
+        return fail("not a RIFF/WAVE file");
+    }
+
+    bool have_format = false;
+    for (;;) {
+        uint8_t header[8];
+        if (!read_bytes(header, sizeof(header))) {
+            return fail("no data chunk");
+        }
+        uint32_t size = get_u32(header + 4);
+
+        if (std::memcmp(header, "fmt ", 4) == 0) {
+            uint8_t fmt[40] = {};
+            if (size < 16 || !read_bytes(fmt, std::min<uint32_t>(size, sizeof(fmt))) ||
+                !skip_bytes(size - std::min<uint32_t>(size, sizeof(fmt)) + (size & 1))) {
+                return fail("truncated fmt chunk");
+            }
+            uint16_t tag = get_u16(fmt);
+            format_.channel_mask = 0;
+            if (tag == FORMAT_EXTENSIBLE && size >= 26) {
+                format_.channel_mask = get_u32(fmt + 20);
+                tag = get_u16(fmt + 24);  // first two bytes of the SubFormat GUID
+            }
+            format_.num_channels = get_u16(fmt + 2);
+            format_.sample_rate = static_cast<int>(get_u32(fmt + 4));
+            format_.bits_per_sample = get_u16(fmt + 14);
+            format_.is_float = (tag == FORMAT_FLOAT);
+
+            bool supported = (tag == FORMAT_PCM && (format_.bits_per_sample == 8 ||
+                                                    format_.bits_per_sample == 16 ||
+                                                    format_.bits_per_sample == 24 ||
+                                                    format_.bits_per_sample == 32)) ||
+                             (tag == FORMAT_FLOAT && format_.bits_per_sample == 32);
+            if (!supported || format_.num_channels < 1 || format_.sample_rate <= 0) {
+                return fail("unsupported sample format");
+            }
+            have_format = true;
+        } else if (std::memcmp(header, "data", 4) == 0) {
+            if (!have_format) {
+                return fail("data chunk before fmt chunk");
+            }
+            size_t frame_bytes = format_.num_channels * (format_.bits_per_sample / 8);
+            // 0 and 0xFFFFFFFF are used by streaming writers for "until EOF"
+            if (size == 0 || size == UNKNOWN_SIZE) {
+                remaining_bytes_ = UINT64_MAX;
+                num_frames_ = 0;
+            } else {
+                remaining_bytes_ = size - size % frame_bytes;
+                num_frames_ = remaining_bytes_ / frame_bytes;
+            }
+            return true;
+        } else if (!skip_bytes(static_cast<uint64_t>(size) + (size & 1))) {
+            return fail("truncated chunk");
+        }
+    }
+}
+
+void WavReader::close() {
+    if (file_ && owns_file_) {
+        std::fclose(file_);
+    }
+    file_ = nullptr;
+    remaining_bytes_ = 0;
+}
+
+size_t WavReader::read(float *const *channels, size_t max_frames) {
+    if (!file_ || remaining_bytes_ == 0) {
+        return 0;
+    }
+
+    const size_t sample_bytes = format_.bits_per_sample / 8;
+    const size_t frame_bytes = format_.num_channels * sample_bytes;
+    size_t frames = static_cast<size_t>(std::min<uint64_t>(max_frames, remaining_bytes_ / frame_bytes));
+    raw_.resize(frames * frame_bytes);
+
+    const size_t got = std::fread(raw_.data(), 1, raw_.size(), file_);
+    frames = got / frame_bytes;
+    if (got < raw_.size()) {
+        // Only a data chunk of unknown length may end at EOF
+        if (std::ferror(file_)) {
+            error_ = "read error";
+        } else if (remaining_bytes_ != UINT64_MAX) {
+            error_ = "truncated data chunk";
+        }
+        remaining_bytes_ = 0;
+    } else if (remaining_bytes_ != UINT64_MAX) {
+        remaining_bytes_ -= got;
+    }
+
+    const uint8_t *p = raw_.data();
+    for (size_t i = 0; i < frames; ++i) {
+        for (int ch = 0; ch < format_.num_channels; ++ch) {
+            channels[ch][i] = decode_sample(p, format_);
+            p += sample_bytes;
+        }
+    }
+    return frames;
+}
+
+// ---------------------------------------------------------------------------
+// WavWriter
+
+WavWriter::~WavWriter() {
+    close();
+}
+
+bool WavWriter::fail(const std::string &message) {
+    error_ = message;
+    return false;
+}
+
+size_t WavWriter::header_bytes() const {
+    return (format_.num_channels > 2 || format_.channel_mask != 0) ? 68 : 44;
+}
+
+bool WavWriter::write_header(uint32_t data_bytes) {
+    const uint16_t block_align = static_cast<uint16_t>(format_.num_channels * (format_.bits_per_sample / 8));
+    const uint16_t tag = format_.is_float ? FORMAT_FLOAT : FORMAT_PCM;
+    const size_t size = header_bytes();
+    const bool extensible = size > 44;
+    const uint32_t fmt_size = extensible ? 40 : 16;
+    const uint32_t riff_size = (data_bytes == UNKNOWN_SIZE)
+                                   ? UNKNOWN_SIZE
+                                   : static_cast<uint32_t>(size - 8) + data_bytes + (data_bytes & 1);
+
+    uint8_t h[68] = {};
+    std::memcpy(h, "RIFF", 4);
+    put_u32(h + 4, riff_size);
+    std::memcpy(h + 8, "WAVEfmt ", 8);
+    put_u32(h + 16, fmt_size);
+    put_u16(h + 20, extensible ? FORMAT_EXTENSIBLE : tag);
+    put_u16(h + 22, static_cast<uint16_t>(format_.num_channels));
+    put_u32(h + 24, static_cast<uint32_t>(format_.sample_rate));
+    put_u32(h + 28, static_cast<uint32_t>(format_.sample_rate) * block_align);
+    put_u16(h + 32, block_align);
+    put_u16(h + 34, static_cast<uint16_t>(format_.bits_per_sample));
+    uint8_t *data = h + 36;
+    if (extensible) {
+        // cbSize, valid bits, channel mask, then the SubFormat GUID
+        // {tag}-0000-0010-8000-00AA00389B71
+        static const uint8_t GUID_TAIL[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+                                              0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+        put_u16(h + 36, 22);
+        put_u16(h + 38, static_cast<uint16_t>(format_.bits_per_sample));
+        put_u32(h + 40, format_.channel_mask);
+        put_u16(h + 44, tag);
+        std::memcpy(h + 46, GUID_TAIL, sizeof(GUID_TAIL));
+        data = h + 60;
+    }
+    std::memcpy(data, "data", 4);
+    put_u32(data + 4, data_bytes);
+
+    return std::fwrite(h, 1, size, file_) == size;
+}
+
+bool WavWriter::open(const char *path, const WavFormat &format) {
+    close();
+    error_.clear();
+    format_ = format;
+    data_bytes_ = 0;
+
+    file_ = open_stream(path, "wb", stdout, &owns_file_);
+    if (!file_) {
+        return fail(std::string("cannot create ") + path);
+    }
+    std::setvbuf(file_, nullptr, _IOFBF, IO_BUFFER_BYTES);
+
+    if (!write_header(UNKNOWN_SIZE)) {
+        return fail("write error");
+    }
+    return true;
+}
+
+bool WavWriter::write(const float *const *channels, size_t num_frames) {
+    if (!file_) {
+        return fail("file not open");
+    }
+
+    const size_t sample_bytes = format_.bits_per_sample / 8;
+    raw_.resize(num_frames * format_.num_channels * sample_bytes);
+
+    uint8_t *p = raw_.data();
+    for (size_t i = 0; i < num_frames; ++i) {
+        for (int ch = 0; ch < format_.num_channels; ++ch) {
+            encode_sample(p, channels[ch][i], format_);
+            p += sample_bytes;
+        }
+    }
+
+    if (std::fwrite(raw_.data(), 1, raw_.size(), file_) != raw_.size()) {
+        return fail("write error");
+    }
+    data_bytes_ += raw_.size();
+    return true;
+}
+
+bool WavWriter::close() {
+    if (!file_) {
+        return error_.empty();
+    }
+
+    bool ok = true;
+    if (data_bytes_ & 1) {
+        ok = std::fputc(0, file_) != EOF;
+    }
+
+    // Patch the real sizes in when the output can seek; RIFF sizes are
+    // 32-bit, so anything larger keeps the "unknown" placeholder.
+    if (ok && data_bytes_ <= UNKNOWN_SIZE - (header_bytes() - 7) && std::fseek(file_, 0, SEEK_SET) == 0) {
+        ok = write_header(static_cast<uint32_t>(data_bytes_));
+    }
+
+    ok = (std::fflush(file_) == 0) && ok;
+    if (owns_file_) {
+        ok = (std::fclose(file_) == 0) && ok;
+    }
+    file_ = nullptr;
+    return ok ? true : fail("write error");
+}
@@ -0,0 +1,96 @@
+#ifndef WAV_STREAM_H
+#define WAV_STREAM_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Buffered, block-at-a-time WAV I/O for offline processing. Only one block of
+// samples is held in memory, so file size does not affect the footprint.
+// A path of "-" means stdin / stdout.
+
+struct WavFormat {
+    int sample_rate = 0;
+    int num_channels = 0;
+    int bits_per_sample = 0;  // 8, 16, 24 or 32
+    bool is_float = false;    // 32-bit IEEE float when true
+    uint32_t channel_mask = 0;  // WAVE_FORMAT_EXTENSIBLE speaker positions, 0 if unspecified
+};
+
+class WavReader {
+public:
+    WavReader() = default;
+    ~WavReader();
+
+    WavReader(const WavReader &) = delete;
+    WavReader &operator=(const WavReader &) = delete;
+
+    // Opens the file and parses the header up to the start of the data chunk.
+    bool open(const char *path);
+    void close();
+
+    const WavFormat &format() const { return format_; }
+
+    // Number of frames in the data chunk, or 0 when the length is unknown
+    // (e.g. a streamed WAV with a placeholder size).
+    uint64_t num_frames() const { return num_frames_; }
+
+    // Reads up to max_frames frames and deinterleaves them into one float
+    // buffer per channel, scaled to [-1, 1). Returns the number of frames
+    // read; 0 at the end of the data. error() is set when the data ends
+    // before the length in the header or the read fails.
+    size_t read(float *const *channels, size_t max_frames);
+
+    const std::string &error() const { return error_; }
+
+private:
+    bool fail(const std::string &message);
+    bool read_bytes(void *dst, size_t n);
+    bool skip_bytes(uint64_t n);
+
+    std::FILE *file_ = nullptr;
+    bool owns_file_ = false;
+    WavFormat format_;
+    uint64_t num_frames_ = 0;
+    uint64_t remaining_bytes_ = 0;  // UINT64_MAX when reading to EOF
+    std::vector<uint8_t> raw_;
+    std::string error_;
+};
+
+class WavWriter {
+public:
+    WavWriter() = default;
+    ~WavWriter();
+
+    WavWriter(const WavWriter &) = delete;
+    WavWriter &operator=(const WavWriter &) = delete;
+
+    // Writes a header with placeholder sizes. The sizes are patched in
+    // close() when the output is seekable; a pipe keeps the 0xFFFFFFFF
+    // "unknown length" placeholder that streaming readers accept. Files with
+    // more than two channels, or a channel mask, get a WAVE_FORMAT_EXTENSIBLE
+    // header so the speaker layout survives.
+    bool open(const char *path, const WavFormat &format);
+    bool close();
+
+    // Interleaves one float buffer per channel, clamps to [-1, 1] and
+    // converts to the output format.
+    bool write(const float *const *channels, size_t num_frames);
+
+    const std::string &error() const { return error_; }
+
+private:
+    bool fail(const std::string &message);
+    bool write_header(uint32_t data_bytes);
+    size_t header_bytes() const;
+
+    std::FILE *file_ = nullptr;
+    bool owns_file_ = false;
+    WavFormat format_;
+    uint64_t data_bytes_ = 0;
+    std::vector<uint8_t> raw_;
+    std::string error_;
+};
+
+#endif // WAV_STREAM_H
@@ -0,0 +1,265 @@
+#include "comb_bank.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace reverb_detail {
+
+template <int Half, bool Frozen>
+void comb_bank_process_scalar(CombBank<Half> &b, const float *pre_l, const float *pre_r,
+                              float *wet_l, float *wet_r, int n) {
+    constexpr int kLanes = 2 * Half;
+    float *tap[kLanes];
+    alignas(32) float weighted[kLanes];
+    for (int t = 0; t < n;) {
+        const int run = comb_run(b, n - t);
+        for (int l = 0; l < kLanes; ++l) {
+            tap[l] = b.line[l] + b.index[l];
+        }
+        for (int j = 0; j < run; ++j, ++t) {
+            for (int l = 0; l < kLanes; ++l) {
+                const float delayed = tap[l][j];
+                if constexpr (Frozen) {
+                    b.last[l] = b.last[l] * (1.0f - b.damp[l]) + delayed * b.damp[l];
+                    tap[l][j] = b.last[l];
+                } else {
+                    float pre = (l < Half) ? pre_l[t] : pre_r[t];
+                    float feedback = delayed * b.feedback[l];
+                    b.last[l] = b.last[l] * (1.0f - b.damp[l]) + feedback * b.damp[l];
+                    tap[l][j] = pre + b.last[l];
+                }
+                weighted[l] = delayed * b.gain[l];
+            }
+            comb_sum<Half>(weighted, wet_l[t], wet_r[t]);
+        }
+        comb_advance(b, run);
+    }
+}
+
+// The SIMD kernels work on tiles of one vector of samples by one vector of
+// lanes. A tile is loaded as one vector per line, holding consecutive
+// samples, and transposed so that the filter update runs across lanes one
+// sample at a time, as in the scalar kernel; the new line inputs and the
+// weighted outputs are transposed back, so the inputs are stored per line
+// and the weighted outputs are summed in comb order for a vector of
+// samples at once. Samples left over at the end of a run go through the
+// same arithmetic one at a time.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+template <int Half, bool Frozen>
+void comb_bank_process_sse2(CombBank<Half> &b, const float *pre_l, const float *pre_r,
+                            float *wet_l, float *wet_r, int n) {
+    constexpr int kLanes = 2 * Half;
+    static_assert(Half % 4 == 0, "SSE2 kernel needs a multiple of 4 combs per channel");
+    float *tap[kLanes];
+    alignas(32) float delayed[kLanes];
+    alignas(32) float in[kLanes];
+    alignas(32) float weighted[kLanes];
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (int t = 0; t < n;) {
+        const int run = comb_run(b, n - t);
+        for (int l = 0; l < kLanes; ++l) {
+            tap[l] = b.line[l] + b.index[l];
+        }
+        int j = 0;
+        for (; j + 4 <= run; j += 4) {
+            __m128 sum_l = _mm_setzero_ps();
+            __m128 sum_r = _mm_setzero_ps();
+            for (int l = 0; l < kLanes; l += 4) {
+                __m128 d[4];
+                for (int k = 0; k < 4; ++k) {
+                    d[k] = _mm_loadu_ps(tap[l + k] + j);
+                }
+                _MM_TRANSPOSE4_PS(d[0], d[1], d[2], d[3]);
+
+                const __m128 damp = _mm_load_ps(&b.damp[l]);
+                const __m128 undamp = _mm_sub_ps(one, damp);
+                const __m128 gain = _mm_load_ps(&b.gain[l]);
+                const float *pre = (l < Half) ? pre_l : pre_r;
+                __m128 last = _mm_load_ps(&b.last[l]);
+                __m128 x[4], w[4];
+                for (int s = 0; s < 4; ++s) {
+                    __m128 feedback = Frozen ? d[s] : _mm_mul_ps(d[s], _mm_load_ps(&b.feedback[l]));
+                    last = _mm_add_ps(_mm_mul_ps(last, undamp), _mm_mul_ps(feedback, damp));
+                    if constexpr (Frozen) {
+                        x[s] = last;
+                    } else {
+                        x[s] = _mm_add_ps(_mm_set1_ps(pre[t + j + s]), last);
+                    }
+                    w[s] = _mm_mul_ps(d[s], gain);
+                }
+                _mm_store_ps(&b.last[l], last);
+
+                _MM_TRANSPOSE4_PS(x[0], x[1], x[2], x[3]);
+                _MM_TRANSPOSE4_PS(w[0], w[1], w[2], w[3]);
+                __m128 &sum = (l < Half) ? sum_l : sum_r;
+                for (int k = 0; k < 4; ++k) {
+                    _mm_storeu_ps(tap[l + k] + j, x[k]);
+                    sum = _mm_add_ps(sum, w[k]);
+                }
+            }
+            _mm_storeu_ps(wet_l + t + j, sum_l);
+            _mm_storeu_ps(wet_r + t + j, sum_r);
+        }
+        for (; j < run; ++j) {
+            for (int l = 0; l < kLanes; ++l) {
+                delayed[l] = tap[l][j];
+            }
+            for (int l = 0; l < kLanes; l += 4) {
+                __m128 d = _mm_load_ps(&delayed[l]);
+                __m128 damp = _mm_load_ps(&b.damp[l]);
+                __m128 feedback = Frozen ? d : _mm_mul_ps(d, _mm_load_ps(&b.feedback[l]));
+                __m128 last = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&b.last[l]), _mm_sub_ps(one, damp)),
+                                         _mm_mul_ps(feedback, damp));
+                _mm_store_ps(&b.last[l], last);
+                if constexpr (Frozen) {
+                    _mm_store_ps(&in[l], last);
+                } else {
+                    const __m128 pre = _mm_set1_ps((l < Half) ? pre_l[t + j] : pre_r[t + j]);
+                    _mm_store_ps(&in[l], _mm_add_ps(pre, last));
+                }
+                _mm_store_ps(&weighted[l], _mm_mul_ps(d, _mm_load_ps(&b.gain[l])));
+            }
+            for (int l = 0; l < kLanes; ++l) {
+                tap[l][j] = in[l];
+            }
+            comb_sum<Half>(weighted, wet_l[t + j], wet_r[t + j]);
+        }
+        comb_advance(b, run);
+        t += run;
+    }
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+static inline void transpose4(float32x4_t &r0, float32x4_t &r1, float32x4_t &r2, float32x4_t &r3) {
+    const float32x4x2_t t01 = vtrnq_f32(r0, r1);
+    const float32x4x2_t t23 = vtrnq_f32(r2, r3);
+    r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+template <int Half, bool Frozen>
+void comb_bank_process_neon(CombBank<Half> &b, const float *pre_l, const float *pre_r,
+                            float *wet_l, float *wet_r, int n) {
+    constexpr int kLanes = 2 * Half;
+    static_assert(Half % 4 == 0, "NEON kernel needs a multiple of 4 combs per channel");
+    float *tap[kLanes];
+    alignas(32) float delayed[kLanes];
+    alignas(32) float in[kLanes];
+    alignas(32) float weighted[kLanes];
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for (int t = 0; t < n;) {
+        const int run = comb_run(b, n - t);
+        for (int l = 0; l < kLanes; ++l) {
+            tap[l] = b.line[l] + b.index[l];
+        }
+        int j = 0;
+        for (; j + 4 <= run; j += 4) {
+            float32x4_t sum_l = vdupq_n_f32(0.0f);
+            float32x4_t sum_r = vdupq_n_f32(0.0f);
+            for (int l = 0; l < kLanes; l += 4) {
+                float32x4_t d[4];
+                for (int k = 0; k < 4; ++k) {
+                    d[k] = vld1q_f32(tap[l + k] + j);
+                }
+                transpose4(d[0], d[1], d[2], d[3]);
+
+                const float32x4_t damp = vld1q_f32(&b.damp[l]);
+                const float32x4_t undamp = vsubq_f32(one, damp);
+                const float32x4_t gain = vld1q_f32(&b.gain[l]);
+                const float *pre = (l < Half) ? pre_l : pre_r;
+                float32x4_t last = vld1q_f32(&b.last[l]);
+                float32x4_t x[4], w[4];
+                for (int s = 0; s < 4; ++s) {
+                    float32x4_t feedback = Frozen ? d[s] : vmulq_f32(d[s], vld1q_f32(&b.feedback[l]));
+                    // Separate multiply and add (no vmla/fma) to round like the scalar kernel
+                    last = vaddq_f32(vmulq_f32(last, undamp), vmulq_f32(feedback, damp));
+                    if constexpr (Frozen) {
+                        x[s] = last;
+                    } else {
+                        x[s] = vaddq_f32(vdupq_n_f32(pre[t + j + s]), last);
+                    }
+                    w[s] = vmulq_f32(d[s], gain);
+                }
+                vst1q_f32(&b.last[l], last);
+
+                transpose4(x[0], x[1], x[2], x[3]);
+                transpose4(w[0], w[1], w[2], w[3]);
+                float32x4_t &sum = (l < Half) ? sum_l : sum_r;
+                for (int k = 0; k < 4; ++k) {
+                    vst1q_f32(tap[l + k] + j, x[k]);
+                    sum = vaddq_f32(sum, w[k]);
+                }
+            }
+            vst1q_f32(wet_l + t + j, sum_l);
+            vst1q_f32(wet_r + t + j, sum_r);
+        }
+        for (; j < run; ++j) {
+            for (int l = 0; l < kLanes; ++l) {
+                delayed[l] = tap[l][j];
+            }
+            for (int l = 0; l < kLanes; l += 4) {
+                float32x4_t d = vld1q_f32(&delayed[l]);
+                float32x4_t damp = vld1q_f32(&b.damp[l]);
+                float32x4_t feedback = Frozen ? d : vmulq_f32(d, vld1q_f32(&b.feedback[l]));
+                float32x4_t last = vaddq_f32(vmulq_f32(vld1q_f32(&b.last[l]), vsubq_f32(one, damp)),
+                                             vmulq_f32(feedback, damp));
+                vst1q_f32(&b.last[l], last);
+                if constexpr (Frozen) {
+                    vst1q_f32(&in[l], last);
+                } else {
+                    const float32x4_t pre = vdupq_n_f32((l < Half) ? pre_l[t + j] : pre_r[t + j]);
+                    vst1q_f32(&in[l], vaddq_f32(pre, last));
+                }
+                vst1q_f32(&weighted[l], vmulq_f32(d, vld1q_f32(&b.gain[l])));
+            }
+            for (int l = 0; l < kLanes; ++l) {
+                tap[l][j] = in[l];
+            }
+            comb_sum<Half>(weighted, wet_l[t + j], wet_r[t + j]);
+        }
+        comb_advance(b, run);
+        t += run;
+    }
+}
+#endif
+
+#define COMB_KERNELS(isa) \
+    {#isa, comb_bank_process_##isa<Half, false>, comb_bank_process_##isa<Half, true>}
+
+template <int Half>
+const CombKernels<Half> *select_comb_kernels(bool simd) {
+    if (simd) {
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__)) && \
+    defined(REVERB_HAVE_AVX)
+        if constexpr (Half % 8 == 0) {
+            static const CombKernels<Half> avx = COMB_KERNELS(avx);
+            if (__builtin_cpu_supports("avx")) {
+                return &avx;
+            }
+        }
+#endif
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+        static const CombKernels<Half> sse2 = COMB_KERNELS(sse2);
+        return &sse2;
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+        static const CombKernels<Half> neon = COMB_KERNELS(neon);
+        return &neon;
+#endif
+    }
+    static const CombKernels<Half> scalar = COMB_KERNELS(scalar);
+    return &scalar;
+}
+
+// Lane counts of the topologies in reverb_topology.h
+template const CombKernels<8> *select_comb_kernels<8>(bool simd);
+template const CombKernels<4> *select_comb_kernels<4>(bool simd);
+
+}  // namespace reverb_detail
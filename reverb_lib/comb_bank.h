@@ -0,0 +1,109 @@
+#ifndef COMB_BANK_H
+#define COMB_BANK_H
+
+// Internal to reverb_lib: structure-of-arrays state for the parallel comb
+// filters and the per-ISA kernels that run them. Everything is templated on
+// the number of combs per channel, so each reverb topology gets kernels with
+// compile-time lane counts.
+
+namespace reverb_detail {
+
+// Lanes [0, Half) are the left channel combs, [Half, 2 * Half) the right
+// channel combs, so one lane set holds both channels.
+template <int Half>
+struct alignas(32) CombBank {
+    static constexpr int kHalf = Half;
+    static constexpr int kLanes = 2 * Half;
+
+    float feedback[kLanes];
+    float damp[kLanes];
+    float last[kLanes];
+    float gain[kLanes];
+    float *line[kLanes];
+    int index[kLanes];
+    int size[kLanes];
+};
+
+// Feeds pre_l / pre_r through every comb for n samples and writes the summed,
+// gain-weighted comb outputs of each channel to wet_l / wet_r.
+//
+// The Frozen instantiations are for blocks that are fully frozen: the input
+// is muted and feedback is exactly 1, so they only recirculate the lines
+// and ignore pre_l / pre_r and bank.feedback. Their output is identical to
+// the general kernel's under those conditions.
+template <int Half>
+using CombKernel = void (*)(CombBank<Half> &bank, const float *pre_l, const float *pre_r,
+                            float *wet_l, float *wet_r, int n);
+
+template <int Half, bool Frozen>
+void comb_bank_process_scalar(CombBank<Half> &bank, const float *pre_l, const float *pre_r,
+                              float *wet_l, float *wet_r, int n);
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+template <int Half, bool Frozen>
+void comb_bank_process_sse2(CombBank<Half> &bank, const float *pre_l, const float *pre_r,
+                            float *wet_l, float *wet_r, int n);
+// Needs Half % 8 == 0, so that no vector straddles the two channels
+template <int Half, bool Frozen>
+void comb_bank_process_avx(CombBank<Half> &bank, const float *pre_l, const float *pre_r,
+                           float *wet_l, float *wet_r, int n);
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+template <int Half, bool Frozen>
+void comb_bank_process_neon(CombBank<Half> &bank, const float *pre_l, const float *pre_r,
+                            float *wet_l, float *wet_r, int n);
+#endif
+
+// The general and frozen kernels of one instruction set
+template <int Half>
+struct CombKernels {
+    const char *name;
+    CombKernel<Half> process;
+    CombKernel<Half> frozen;
+};
+
+// Best kernels for the running CPU, or the scalar ones when simd is false.
+// Instantiated in comb_bank.cpp for the lane counts of the shipped
+// topologies (see reverb_topology.h).
+template <int Half>
+const CombKernels<Half> *select_comb_kernels(bool simd);
+
+// Shared by all kernels: how many of the next n samples every line can take
+// without wrapping. Over such a run each line is read and written at
+// consecutive addresses from line + index, so the kernels can load and store
+// whole vectors of one line's samples. Every read comes before the write to
+// the same slot, and no slot is visited twice in a run, so this matches
+// processing the samples one at a time whatever the line lengths.
+template <int Half>
+inline int comb_run(const CombBank<Half> &b, int n) {
+    for (int l = 0; l < b.kLanes; ++l) {
+        const int left = b.size[l] - b.index[l];
+        if (left < n) n = left;
+    }
+    return n;
+}
+
+// Shared by all kernels: move every line past a run of comb_run() samples.
+template <int Half>
+inline void comb_advance(CombBank<Half> &b, int run) {
+    for (int l = 0; l < b.kLanes; ++l) {
+        b.index[l] += run;
+        if (b.index[l] >= b.size[l]) b.index[l] = 0;
+    }
+}
+
+// Shared by all kernels: sum the weighted outputs per channel in comb order,
+// so every kernel rounds exactly like the scalar one.
+template <int Half>
+inline void comb_sum(const float *weighted, float &wet_l, float &wet_r) {
+    float sum_l = 0.0f, sum_r = 0.0f;
+    for (int k = 0; k < Half; ++k) {
+        sum_l += weighted[k];
+        sum_r += weighted[Half + k];
+    }
+    wet_l = sum_l;
+    wet_r = sum_r;
+}
+
+}  // namespace reverb_detail
+
+#endif // COMB_BANK_H
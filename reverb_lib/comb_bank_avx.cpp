@@ -0,0 +1,128 @@
+// Built with AVX enabled; only called after a runtime CPU check.
+#include "comb_bank.h"
+
+#include <immintrin.h>
+
+namespace reverb_detail {
+
+static inline void transpose8(__m256 r[8]) {
+    const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    const __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+    const __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    const __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+    const __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    const __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+    const __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+    const __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+    r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+    r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+    r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+    r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+    r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+    r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+    r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+// Same tiling as the SSE2 kernel (see comb_bank.cpp), eight samples by
+// eight lanes
+template <int Half, bool Frozen>
+void comb_bank_process_avx(CombBank<Half> &b, const float *pre_l, const float *pre_r,
+                           float *wet_l, float *wet_r, int n) {
+    constexpr int kLanes = 2 * Half;
+    static_assert(Half % 8 == 0, "AVX kernel needs a multiple of 8 combs per channel");
+    float *tap[kLanes];
+    alignas(32) float delayed[kLanes];
+    alignas(32) float in[kLanes];
+    alignas(32) float weighted[kLanes];
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for (int t = 0; t < n;) {
+        const int run = comb_run(b, n - t);
+        for (int l = 0; l < kLanes; ++l) {
+            tap[l] = b.line[l] + b.index[l];
+        }
+        int j = 0;
+        for (; j + 8 <= run; j += 8) {
+            __m256 sum_l = _mm256_setzero_ps();
+            __m256 sum_r = _mm256_setzero_ps();
+            for (int l = 0; l < kLanes; l += 8) {
+                __m256 d[8];
+                for (int k = 0; k < 8; ++k) {
+                    d[k] = _mm256_loadu_ps(tap[l + k] + j);
+                }
+                transpose8(d);
+
+                const __m256 damp = _mm256_load_ps(&b.damp[l]);
+                const __m256 undamp = _mm256_sub_ps(one, damp);
+                const __m256 gain = _mm256_load_ps(&b.gain[l]);
+                const float *pre = (l < Half) ? pre_l : pre_r;
+                __m256 last = _mm256_load_ps(&b.last[l]);
+                __m256 x[8], w[8];
+                for (int s = 0; s < 8; ++s) {
+                    __m256 feedback = Frozen ? d[s] : _mm256_mul_ps(d[s], _mm256_load_ps(&b.feedback[l]));
+                    last = _mm256_add_ps(_mm256_mul_ps(last, undamp), _mm256_mul_ps(feedback, damp));
+                    if constexpr (Frozen) {
+                        x[s] = last;
+                    } else {
+                        x[s] = _mm256_add_ps(_mm256_set1_ps(pre[t + j + s]), last);
+                    }
+                    w[s] = _mm256_mul_ps(d[s], gain);
+                }
+                _mm256_store_ps(&b.last[l], last);
+
+                transpose8(x);
+                transpose8(w);
+                __m256 &sum = (l < Half) ? sum_l : sum_r;
+                for (int k = 0; k < 8; ++k) {
+                    _mm256_storeu_ps(tap[l + k] + j, x[k]);
+                    sum = _mm256_add_ps(sum, w[k]);
+                }
+            }
+            _mm256_storeu_ps(wet_l + t + j, sum_l);
+            _mm256_storeu_ps(wet_r + t + j, sum_r);
+        }
+        for (; j < run; ++j) {
+            for (int l = 0; l < kLanes; ++l) {
+                delayed[l] = tap[l][j];
+            }
+            for (int l = 0; l < kLanes; l += 8) {
+                __m256 d = _mm256_load_ps(&delayed[l]);
+                __m256 damp = _mm256_load_ps(&b.damp[l]);
+                __m256 feedback = Frozen ? d : _mm256_mul_ps(d, _mm256_load_ps(&b.feedback[l]));
+                __m256 last =
+                    _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(&b.last[l]), _mm256_sub_ps(one, damp)),
+                                  _mm256_mul_ps(feedback, damp));
+                _mm256_store_ps(&b.last[l], last);
+                if constexpr (Frozen) {
+                    _mm256_store_ps(&in[l], last);
+                } else {
+                    const __m256 pre = _mm256_set1_ps((l < Half) ? pre_l[t + j] : pre_r[t + j]);
+                    _mm256_store_ps(&in[l], _mm256_add_ps(pre, last));
+                }
+                _mm256_store_ps(&weighted[l], _mm256_mul_ps(d, _mm256_load_ps(&b.gain[l])));
+            }
+            for (int l = 0; l < kLanes; ++l) {
+                tap[l][j] = in[l];
+            }
+            comb_sum<Half>(weighted, wet_l[t + j], wet_r[t + j]);
+        }
+        comb_advance(b, run);
+        t += run;
+    }
+}
+
+// Only the 8-combs-per-channel bank has an AVX kernel
+template void comb_bank_process_avx<8, false>(CombBank<8> &, const float *, const float *,
+                                              float *, float *, int);
+template void comb_bank_process_avx<8, true>(CombBank<8> &, const float *, const float *,
+                                             float *, float *, int);
+
+}  // namespace reverb_detail
@@ -0,0 +1,168 @@
+#include "multichannel_reverb.h"
+
+#include <algorithm>
+
+namespace {
+    // Delay stretch between consecutive channel pairs. Small enough that
+    // the room does not audibly change size, large enough that no comb of
+    // one pair lines up with a comb of another.
+    const float PAIR_SPREAD = 0.037f;
+}
+
+MultichannelReverb::MultichannelReverb(int num_channels, float sample_rate, int threads,
+                                       std::pmr::memory_resource *memory)
+    : num_channels_(0), sample_rate_(sample_rate), memory_(memory), enabled_(true), frozen_(false),
+      simd_(true), wet_(0.5f), dry_(0.5f), decay_(1.0f), channels_(nullptr), num_frames_(0),
+      generation_(0), busy_(0), stop_(false) {
+    configure(num_channels, sample_rate);
+    for (int i = 1; i < threads; ++i) {
+        workers_.emplace_back(&MultichannelReverb::worker_main, this, i);
+    }
+}
+
+MultichannelReverb::~MultichannelReverb() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        stop_ = true;
+    }
+    start_.notify_all();
+    for (std::thread &worker : workers_) {
+        worker.join();
+    }
+}
+
+void MultichannelReverb::configure(int num_channels, float sample_rate, bool lazy) {
+    num_channels_ = std::max(1, num_channels);
+    sample_rate_ = sample_rate;
+
+    const size_t kept = std::min<size_t>(pairs_.size(), num_pairs());
+    for (size_t k = 0; k < kept; ++k) {
+        pairs_[k]->set_sample_rate(sample_rate, lazy);
+    }
+    for (size_t k = pairs_.size(); k < static_cast<size_t>(num_pairs()); ++k) {
+        auto reverb = std::make_unique<Reverb>(sample_rate, memory_, 1.0f + PAIR_SPREAD * k);
+        reverb->set_enabled(enabled_.load(std::memory_order_relaxed));
+        reverb->set_freeze(frozen_.load(std::memory_order_relaxed));
+        reverb->set_simd(simd_.load(std::memory_order_relaxed));
+        reverb->set_wet(wet_.load(std::memory_order_relaxed));
+        reverb->set_dry(dry_.load(std::memory_order_relaxed));
+        reverb->set_decay(decay_.load(std::memory_order_relaxed));
+        reverb->reset();  // start settled on the parameters, not ramping to them
+        pairs_.push_back(std::move(reverb));
+    }
+}
+
+void MultichannelReverb::reset(bool lazy) {
+    for (int k = 0; k < num_pairs(); ++k) {
+        pairs_[k]->reset(lazy);
+    }
+}
+
+void MultichannelReverb::process(float *const *channels, int num_frames) {
+    if (num_channels_ % 2 != 0) {
+        // The odd channel's pair reads the channel from both sides; its
+        // right side works on a copy so the left output cannot overwrite
+        // input the right side has yet to read.
+        odd_right_.assign(channels[num_channels_ - 1], channels[num_channels_ - 1] + num_frames);
+    }
+
+    const int step = static_cast<int>(workers_.size()) + 1;
+    if (step == 1 || num_pairs() == 1) {
+        channels_ = channels;
+        num_frames_ = num_frames;
+        process_pairs(0, 1);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        channels_ = channels;
+        num_frames_ = num_frames;
+        busy_ = static_cast<int>(workers_.size());
+        ++generation_;
+    }
+    start_.notify_all();
+    process_pairs(0, step);
+
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    done_.wait(lock, [this] { return busy_ == 0; });
+}
+
+void MultichannelReverb::process_pairs(int first, int step) {
+    for (int k = first; k < num_pairs(); k += step) {
+        float *left = channels_[2 * k];
+        float *right = (2 * k + 1 < num_channels_) ? channels_[2 * k + 1] : odd_right_.data();
+        pairs_[k]->process(left, right, num_frames_);
+    }
+}
+
+void MultichannelReverb::worker_main(int index) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex_);
+            start_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+
+        process_pairs(index, static_cast<int>(workers_.size()) + 1);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex_);
+            last = (--busy_ == 0);
+        }
+        if (last) {
+            done_.notify_one();
+        }
+    }
+}
+
+void MultichannelReverb::set_enabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+    for (auto &pair : pairs_) {
+        pair->set_enabled(enabled);
+    }
+}
+
+void MultichannelReverb::set_freeze(bool freeze_on) {
+    frozen_.store(freeze_on, std::memory_order_relaxed);
+    for (auto &pair : pairs_) {
+        pair->set_freeze(freeze_on);
+    }
+}
+
+void MultichannelReverb::set_wet(float wet) {
+    wet_.store(wet, std::memory_order_relaxed);
+    for (auto &pair : pairs_) {
+        pair->set_wet(wet);
+    }
+}
+
+void MultichannelReverb::set_dry(float dry) {
+    dry_.store(dry, std::memory_order_relaxed);
+    for (auto &pair : pairs_) {
+        pair->set_dry(dry);
+    }
+}
+
+void MultichannelReverb::set_decay(float decay) {
+    decay_.store(decay, std::memory_order_relaxed);
+    for (auto &pair : pairs_) {
+        pair->set_decay(decay);
+    }
+}
+
+void MultichannelReverb::set_simd(bool enabled) {
+    simd_.store(enabled, std::memory_order_relaxed);
+    for (auto &pair : pairs_) {
+        pair->set_simd(enabled);
+    }
+}
+
+const char *MultichannelReverb::simd_name() const {
+    return pairs_.front()->simd_name();
+}
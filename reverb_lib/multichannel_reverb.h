@@ -0,0 +1,93 @@
+#ifndef MULTICHANNEL_REVERB_H
+#define MULTICHANNEL_REVERB_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "reverb.h"
+
+// Reverb for any number of channels (5.1, 7.1, ambisonic B-format, ...)
+// under one parameter set. Channels are taken in pairs, each run by its own
+// Reverb and so on its SIMD comb kernels; an odd last channel is fed to
+// both inputs of its pair and only the left output is kept. Pair k has its
+// delay lines stretched by 1 + 0.037 k, so the tails of different pairs are
+// decorrelated while decaying alike, and pair 0 is exactly a plain Reverb:
+// a stereo file comes out as it would from Reverb itself.
+class MultichannelReverb {
+public:
+    // With `threads` > 1 the pairs of each block are spread over that many
+    // threads, the caller's included; the extra ones are started here and
+    // wait between blocks. Delay lines come from `memory` as for Reverb.
+    MultichannelReverb(int num_channels, float sample_rate, int threads = 1,
+                       std::pmr::memory_resource *memory = nullptr);
+    ~MultichannelReverb();
+
+    MultichannelReverb(const MultichannelReverb &) = delete;
+    MultichannelReverb &operator=(const MultichannelReverb &) = delete;
+
+    // Switches to another channel count and rate, e.g. for the next file.
+    // Pairs already there are kept and reset through
+    // Reverb::set_sample_rate(), reusing their delay pools; parameter
+    // settings carry over. Unlike the setters, configure() and reset() must
+    // not run concurrently with any other member.
+    void configure(int num_channels, float sample_rate, bool lazy = false);
+    void reset(bool lazy = false);
+
+    int num_channels() const { return num_channels_; }
+    float sample_rate() const { return sample_rate_; }
+
+    // Processes one planar buffer per channel in place.
+    void process(float *const *channels, int num_frames);
+
+    // Same as Reverb: lock-free, callable from any thread while another is
+    // inside process(), applied to every pair.
+    void set_enabled(bool enabled);
+    void set_freeze(bool freeze_on);
+    void set_wet(float wet);
+    void set_dry(float dry);
+    void set_decay(float decay);
+    void set_simd(bool enabled);
+    const char *simd_name() const;
+
+private:
+    int num_pairs() const { return (num_channels_ + 1) / 2; }
+    void process_pairs(int first, int step);
+    void worker_main(int index);
+
+    int num_channels_;
+    float sample_rate_;
+    std::pmr::memory_resource *memory_;
+    std::vector<std::unique_ptr<Reverb>> pairs_;  // may hold more than num_pairs()
+    std::vector<float> odd_right_;                // right input/output of an odd last channel
+
+    // Last value given to each setter, for pairs added by configure()
+    std::atomic<bool> enabled_;
+    std::atomic<bool> frozen_;
+    std::atomic<bool> simd_;
+    std::atomic<float> wet_;
+    std::atomic<float> dry_;
+    std::atomic<float> decay_;
+
+    // The block being processed, read by the workers
+    float *const *channels_;
+    int num_frames_;
+
+    // Worker pool. Each block bumps generation_; every worker runs its share
+    // of pairs once per generation and the caller waits for busy_ to drop
+    // to zero.
+    std::vector<std::thread> workers_;
+    std::mutex pool_mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    uint64_t generation_;
+    int busy_;
+    bool stop_;
+};
+
+#endif // MULTICHANNEL_REVERB_H
@@ -1,166 +1,506 @@
 #include "reverb.h"
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
 // Constants adapted from the original C file
 namespace {
-    const int NUM_COMB = 8;
-    const int NUM_AP = 4;
     const float WET = 0.50f;
     const float DRY = 0.50f;
     const float DAMP = 0.40f;
     const float ALLPASS_GAIN = 0.50f;
     const float MASTER_GAIN = 1.50f;
     const float DESIGN_SAMPLE_RATE = 48000.0f;
+    const int PREDELAY_48k = 960;
+
+    // Samples per pass through the pre-delay, comb and allpass stages
+    const int BLOCK = 256;
+
+    // Time for a full-scale parameter change, e.g. wet 0 -> 1 or freeze on
+    const float RAMP_SECONDS = 0.05f;
+
+    // Input plus tail energy per stereo frame below which a block counts as
+    // silent: -90 dBFS RMS per channel, about one 16-bit LSB
+    const float SILENCE_ENERGY = 2.0e-9f;
+
+    // Flushes denormals to zero while in scope and restores the caller's
+    // mode afterwards. A decaying tail otherwise ends in subnormal floats,
+    // which cost around a hundred cycles per operation on x86.
+    class DenormalGuard {
+    public:
+#if defined(__SSE__) || defined(_M_X64)
+        DenormalGuard() : saved_(_mm_getcsr()) { _mm_setcsr(saved_ | 0x8040); }  // FTZ | DAZ
+        ~DenormalGuard() { _mm_setcsr(saved_); }
+
+    private:
+        unsigned int saved_;
+#elif defined(__aarch64__)
+        DenormalGuard() {
+            __asm__ __volatile__("mrs %0, fpcr" : "=r"(saved_));
+            __asm__ __volatile__("msr fpcr, %0" : : "r"(saved_ | (1ull << 24)));  // FZ
+        }
+        ~DenormalGuard() { __asm__ __volatile__("msr fpcr, %0" : : "r"(saved_)); }
+
+    private:
+        unsigned long long saved_;
+#endif
+    };
 
-    // Delay lengths for 48kHz sample rate
-    const int COMB_DLY_L_48k[] = {509, 863, 1481, 2521, 4273, 7253, 10007, 15013};
-    const int COMB_DLY_R_48k[] = {523, 877, 1489, 2531, 4283, 7283, 10037, 15031};
-    const int AP_DLY_L_48k[] = {142, 396, 1071, 3079};
-    const int AP_DLY_R_48k[] = {145, 399, 1073, 3081};
-    const float COMB_T60[] = {0.25f, 0.30f, 0.40f, 0.80f, 2.00f, 6.00f, 10.00f, 20.00f};
-    const float COMB_GAIN[] = {0.62f, 0.60f, 0.58f, 0.55f, 0.52f, 0.50f, 0.48f, 0.45f};
+    float input_energy(const float *left, const float *right, int stride, int n) {
+        float energy = 0.0f;
+        for (int i = 0; i < n; ++i) {
+            energy += left[i * stride] * left[i * stride] + right[i * stride] * right[i * stride];
+        }
+        return energy;
+    }
 }
 
-Reverb::Reverb(float sample_rate) : sample_rate_(sample_rate), enabled_(true), frozen_(false), predelay_index_(0) {
-    init_filters();
+template <typename Topology>
+BasicReverb<Topology>::BasicReverb(float sample_rate, std::pmr::memory_resource *memory,
+                                   float delay_scale)
+    : sample_rate_(sample_rate), delay_scale_(delay_scale), enabled_(true), frozen_(false),
+      wet_target_(WET), dry_target_(DRY), decay_target_(1.0f),
+      wet_{WET}, dry_{DRY}, decay_{1.0f}, freeze_{0.0f},
+      ramp_step_(1.0f / (RAMP_SECONDS * sample_rate)), feedback_decay_(0.0f), feedback_freeze_(0.0f),
+      predelay_(nullptr), predelay_size_(0), predelay_index_(0), predelay_silent_(0),
+      memory_(memory ? memory : std::pmr::get_default_resource()), pool_(nullptr), pool_floats_(0),
+      pool_used_(0), lazy_clear_(false), predelay_stale_(0), comb_stale_{}, ap_stale_left_{},
+      ap_stale_right_{}, tail_hold_(0), quiet_frames_(0), sleeping_(false) {
+    set_simd(true);
+    layout_lines();
+    clear_lines(false);
+    update_feedback();
 }
 
-Reverb::~Reverb() {
-    // std::vector will handle memory deallocation
+template <typename Topology>
+BasicReverb<Topology>::~BasicReverb() {
+    if (pool_) {
+        memory_->deallocate(pool_, pool_floats_ * sizeof(float), kPoolAlign);
+    }
 }
 
-void Reverb::init_filters() {
+// Sizes the delay lines for sample_rate_ and places them in the pool,
+// reallocating only when the pool is too small. Line contents are left to
+// clear_lines().
+template <typename Topology>
+void BasicReverb<Topology>::layout_lines() {
     float sr_ratio = sample_rate_ / DESIGN_SAMPLE_RATE;
 
-    // Pre-delay buffers
-    int predelay_samples = static_cast<int>(960 * sr_ratio);
-    predelay_buffer_left_.assign(predelay_samples, 0.0f);
-    predelay_buffer_right_.assign(predelay_samples, 0.0f);
-
-    // Comb filters
-    combs_left_.resize(NUM_COMB);
-    combs_right_.resize(NUM_COMB);
-    original_feedback_left_.resize(NUM_COMB);
-    original_feedback_right_.resize(NUM_COMB);
-
-    for (int i = 0; i < NUM_COMB; ++i) {
-        int comb_delay_l = static_cast<int>(COMB_DLY_L_48k[i] * sr_ratio);
-        int comb_delay_r = static_cast<int>(COMB_DLY_R_48k[i] * sr_ratio);
-        combs_left_[i].buffer.assign(comb_delay_l, 0.0f);
-        combs_left_[i].index = 0;
-        combs_left_[i].damp = DAMP;
-        combs_left_[i].last = 0.0f;
-
-        combs_right_[i].buffer.assign(comb_delay_r, 0.0f);
-        combs_right_[i].index = 0;
-        combs_right_[i].damp = DAMP;
-        combs_right_[i].last = 0.0f;
-
-        // Calculate and store original feedback
-        float g = powf(10.f, -3.f * comb_delay_l / sample_rate_ / COMB_T60[i]);
-        original_feedback_left_[i] = combs_left_[i].feedback = (g > 0.98f) ? 0.98f : g;
-        g = powf(10.f, -3.f * comb_delay_r / sample_rate_ / COMB_T60[i]);
-        original_feedback_right_[i] = combs_right_[i].feedback = (g > 0.98f) ? 0.98f : g;
+    // Line lengths at this rate. Lane k is left comb k, lane kCombs + k is
+    // right comb k.
+    predelay_size_ = static_cast<int>(PREDELAY_48k * sr_ratio);
+    sr_ratio *= delay_scale_;
+    std::array<int, kCombLanes> comb_delay;
+    for (int i = 0; i < kCombs; ++i) {
+        comb_delay[i] = static_cast<int>(Topology::comb_delay_left[i] * sr_ratio);
+        comb_delay[kCombs + i] = static_cast<int>(Topology::comb_delay_right[i] * sr_ratio);
+    }
+    std::array<int, kAllpasses> ap_delay_l, ap_delay_r;
+    for (int i = 0; i < kAllpasses; ++i) {
+        ap_delay_l[i] = static_cast<int>(Topology::allpass_delay_left[i] * sr_ratio);
+        ap_delay_r[i] = static_cast<int>(Topology::allpass_delay_right[i] * sr_ratio);
+    }
+
+    // One allocation for all of them, handed out in processing order. Lines
+    // are rounded up to whole cache lines so each starts on one.
+    constexpr size_t kLineFloats = kPoolAlign / sizeof(float);
+    auto padded = [](size_t n) { return (n + kLineFloats - 1) / kLineFloats * kLineFloats; };
+    size_t total = padded(2 * static_cast<size_t>(predelay_size_));
+    for (int d : comb_delay) total += padded(d);
+    for (int i = 0; i < kAllpasses; ++i) total += padded(ap_delay_l[i]) + padded(ap_delay_r[i]);
+
+    if (total > pool_floats_) {
+        if (pool_) {
+            memory_->deallocate(pool_, pool_floats_ * sizeof(float), kPoolAlign);
+            pool_ = nullptr;
+            pool_floats_ = 0;
+        }
+        pool_ = static_cast<float *>(memory_->allocate(total * sizeof(float), kPoolAlign));
+        pool_floats_ = total;
+    }
+    pool_used_ = total;
+    float *next = pool_;
+    auto take = [&next, &padded](size_t n) {
+        float *line = next;
+        next += padded(n);
+        return line;
+    };
+
+    // Pre-delay, both channels in one line: the two are always read and
+    // written at the same index
+    predelay_ = take(2 * static_cast<size_t>(predelay_size_));
+
+    // Comb filters, each left line next to its right partner
+    for (int i = 0; i < kCombs; ++i) {
+        combs_.line[i] = take(comb_delay[i]);
+        combs_.line[kCombs + i] = take(comb_delay[kCombs + i]);
+    }
+    for (int lane = 0; lane < kCombLanes; ++lane) {
+        combs_.size[lane] = comb_delay[lane];
+        combs_.damp[lane] = DAMP;
+        combs_.gain[lane] = Topology::comb_gain[lane % kCombs];
+
+        // Feedback for a decay scale d is 10^(exponent / d)
+        feedback_exponent_[lane] = -3.f * comb_delay[lane] / sample_rate_ / Topology::comb_t60[lane % kCombs];
     }
 
     // All-pass filters
-    allpasses_left_.resize(NUM_AP);
-    allpasses_right_.resize(NUM_AP);
-    for (int i = 0; i < NUM_AP; ++i) {
-        int ap_delay_l = static_cast<int>(AP_DLY_L_48k[i] * sr_ratio);
-        int ap_delay_r = static_cast<int>(AP_DLY_R_48k[i] * sr_ratio);
-        allpasses_left_[i].buffer.assign(ap_delay_l, 0.0f);
+    for (int i = 0; i < kAllpasses; ++i) {
+        allpasses_left_[i] = {take(ap_delay_l[i]), ap_delay_l[i], 0};
+        allpasses_right_[i] = {take(ap_delay_r[i]), ap_delay_r[i], 0};
+    }
+
+    // Frames for anything still in the lines to reach the output
+    tail_hold_ = predelay_size_ + *std::max_element(comb_delay.begin(), comb_delay.end());
+    for (int i = 0; i < kAllpasses; ++i) {
+        tail_hold_ += std::max(ap_delay_l[i], ap_delay_r[i]);
+    }
+
+    // The exponents changed, so force update_feedback() to recompute
+    feedback_decay_ = 0.0f;
+}
+
+// Rewinds every line and clears the filter state. Eagerly, the whole pool is
+// zeroed here. Lazily, each line only records that its first lap is still
+// stale, and process() zeroes it a block at a time just ahead of the read
+// position (see clear_ahead), so no sample is read before it is cleared.
+template <typename Topology>
+void BasicReverb<Topology>::clear_lines(bool lazy) {
+    predelay_index_ = 0;
+    predelay_silent_ = 0;
+    for (int lane = 0; lane < kCombLanes; ++lane) {
+        combs_.index[lane] = 0;
+        combs_.last[lane] = 0.0f;
+    }
+    for (int i = 0; i < kAllpasses; ++i) {
         allpasses_left_[i].index = 0;
-        allpasses_right_[i].buffer.assign(ap_delay_r, 0.0f);
         allpasses_right_[i].index = 0;
     }
+
+    if (!lazy) {
+        std::fill(pool_, pool_ + pool_used_, 0.0f);
+        lazy_clear_ = false;
+        return;
+    }
+    predelay_stale_ = predelay_size_;
+    for (int lane = 0; lane < kCombLanes; ++lane) {
+        comb_stale_[lane] = combs_.size[lane];
+    }
+    for (int i = 0; i < kAllpasses; ++i) {
+        ap_stale_left_[i] = allpasses_left_[i].size;
+        ap_stale_right_[i] = allpasses_right_[i].size;
+    }
+    lazy_clear_ = true;
 }
 
-void Reverb::set_enabled(bool enabled) {
-    enabled_ = enabled;
+namespace {
+    // Zeroes the `n` samples of a line that are read next, from `index` on,
+    // while `stale` samples of its first lap since a lazy clear remain.
+    // `width` is the number of floats per sample (2 for interleaved lines).
+    void clear_ahead(float *line, int size, int index, int n, int &stale, int width = 1) {
+        int todo = std::min(n, stale);
+        stale -= todo;
+        while (todo > 0) {
+            const int run = std::min(todo, size - index);
+            std::fill(line + index * width, line + (index + run) * width, 0.0f);
+            index = (index + run == size) ? 0 : index + run;
+            todo -= run;
+        }
+    }
 }
 
-void Reverb::set_freeze(bool freeze_on) {
-    if (freeze_on == frozen_) return;
+template <typename Topology>
+void BasicReverb<Topology>::clear_next(int n) {
+    bool stale = false;
+    clear_ahead(predelay_, predelay_size_, predelay_index_, n, predelay_stale_, 2);
+    stale |= predelay_stale_ > 0;
+    for (int lane = 0; lane < kCombLanes; ++lane) {
+        clear_ahead(combs_.line[lane], combs_.size[lane], combs_.index[lane], n, comb_stale_[lane]);
+        stale |= comb_stale_[lane] > 0;
+    }
+    for (int i = 0; i < kAllpasses; ++i) {
+        Allpass &l = allpasses_left_[i];
+        Allpass &r = allpasses_right_[i];
+        clear_ahead(l.buffer, l.size, l.index, n, ap_stale_left_[i]);
+        clear_ahead(r.buffer, r.size, r.index, n, ap_stale_right_[i]);
+        stale |= ap_stale_left_[i] > 0 || ap_stale_right_[i] > 0;
+    }
+    lazy_clear_ = stale;
+}
 
-    frozen_ = freeze_on;
-    if (frozen_) {
-        for (int i = 0; i < NUM_COMB; ++i) {
-            combs_left_[i].feedback = 1.0f;
-            combs_right_[i].feedback = 1.0f;
-        }
-    } else {
-        for (int i = 0; i < NUM_COMB; ++i) {
-            combs_left_[i].feedback = original_feedback_left_[i];
-            combs_right_[i].feedback = original_feedback_right_[i];
+template <typename Topology>
+void BasicReverb<Topology>::reset(bool lazy) {
+    // Snap the ramps to their targets so the next block starts settled
+    wet_.value = wet_target_.load(std::memory_order_relaxed);
+    dry_.value = dry_target_.load(std::memory_order_relaxed);
+    decay_.value = decay_target_.load(std::memory_order_relaxed);
+    freeze_.value = frozen_.load(std::memory_order_relaxed) ? 1.0f : 0.0f;
+    quiet_frames_ = 0;
+    sleeping_ = false;
+    clear_lines(lazy);
+    update_feedback();
+}
+
+template <typename Topology>
+void BasicReverb<Topology>::set_sample_rate(float sample_rate, bool lazy) {
+    if (sample_rate != sample_rate_) {
+        sample_rate_ = sample_rate;
+        ramp_step_ = 1.0f / (RAMP_SECONDS * sample_rate);
+        layout_lines();
+    }
+    reset(lazy);
+}
+
+template <typename Topology>
+float BasicReverb<Topology>::Ramp::advance(float target, float max_step) {
+    if (value < target) {
+        value = std::min(target, value + max_step);
+    } else if (value > target) {
+        value = std::max(target, value - max_step);
+    }
+    return value;
+}
+
+// Recomputes comb feedback when the ramped decay or freeze amount moved
+// since the last block. Freezing blends every comb toward unity feedback.
+template <typename Topology>
+void BasicReverb<Topology>::update_feedback() {
+    const float decay = decay_.value;
+    const float freeze = freeze_.value;
+    const bool decay_changed = (decay != feedback_decay_);
+    if (!decay_changed && freeze == feedback_freeze_) {
+        return;
+    }
+
+    for (int lane = 0; lane < kCombLanes; ++lane) {
+        if (decay_changed) {
+            float g = powf(10.f, feedback_exponent_[lane] / decay);
+            decay_feedback_[lane] = (g > 0.98f) ? 0.98f : g;
         }
+        const float g = decay_feedback_[lane];
+        combs_.feedback[lane] = (freeze >= 1.0f) ? 1.0f : g + (1.0f - g) * freeze;
     }
+    feedback_decay_ = decay;
+    feedback_freeze_ = freeze;
+}
+
+template <typename Topology>
+void BasicReverb<Topology>::set_enabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+template <typename Topology>
+void BasicReverb<Topology>::set_freeze(bool freeze_on) {
+    frozen_.store(freeze_on, std::memory_order_relaxed);
+}
+
+template <typename Topology>
+void BasicReverb<Topology>::set_wet(float wet) {
+    wet_target_.store(wet, std::memory_order_relaxed);
+}
+
+template <typename Topology>
+void BasicReverb<Topology>::set_dry(float dry) {
+    dry_target_.store(dry, std::memory_order_relaxed);
+}
+
+template <typename Topology>
+void BasicReverb<Topology>::set_decay(float decay) {
+    decay_target_.store(std::max(decay, 0.01f), std::memory_order_relaxed);
+}
+
+template <typename Topology>
+void BasicReverb<Topology>::set_simd(bool enabled) {
+    comb_kernels_.store(reverb_detail::select_comb_kernels<kCombs>(enabled), std::memory_order_relaxed);
+}
+
+template <typename Topology>
+const char *BasicReverb<Topology>::simd_name() const {
+    return comb_kernels_.load(std::memory_order_relaxed)->name;
+}
+
+template <typename Topology>
+void BasicReverb<Topology>::process(float* in_left, float* in_right, int num_samples) {
+    process_strided(in_left, in_right, 1, in_left, in_right, 1, num_samples);
+}
+
+template <typename Topology>
+void BasicReverb<Topology>::process_interleaved(const float *in, float *out, int num_frames) {
+    process_strided(in, in + 1, 2, out, out + 1, 2, num_frames);
 }
 
-void Reverb::process(float* in_left, float* in_right, int num_samples) {
-    if (!enabled_) {
+template <typename Topology>
+void BasicReverb<Topology>::process_strided(const float *in_left, const float *in_right, int in_stride,
+                             float *out_left, float *out_right, int out_stride, int num_frames) {
+    if (!enabled_.load(std::memory_order_relaxed)) {
+        // Bypass; nothing to do when processing in place
+        if (in_left != out_left || in_right != out_right || in_stride != out_stride) {
+            for (int i = 0; i < num_frames; ++i) {
+                out_left[i * out_stride] = in_left[i * in_stride];
+                out_right[i * out_stride] = in_right[i * in_stride];
+            }
+        }
         return;
     }
 
-    for (int i = 0; i < num_samples; ++i) {
-        float dry_left = in_left[i];
-        float dry_right = in_right[i];
+    const CombKernels &kernels = *comb_kernels_.load(std::memory_order_relaxed);
+    const DenormalGuard denormal_guard;
 
-        // Pre-delay and input muting for freeze
-        float pre_left = predelay_buffer_left_[predelay_index_];
-        float pre_right = predelay_buffer_right_[predelay_index_];
-        predelay_buffer_left_[predelay_index_] = frozen_ ? 0.0f : dry_left;
-        predelay_buffer_right_[predelay_index_] = frozen_ ? 0.0f : dry_right;
-        if (++predelay_index_ >= predelay_buffer_left_.size()) {
-            predelay_index_ = 0;
+    for (int start = 0; start < num_frames; start += BLOCK) {
+        const int n = std::min(BLOCK, num_frames - start);
+
+        // Pick up parameter changes at the block boundary. Gains ramp
+        // linearly across the block; feedback steps once per block.
+        const float step = ramp_step_ * n;
+        const float freeze0 = freeze_.value;
+        const float wet0 = wet_.value;
+        const float dry0 = dry_.value * (1.0f - freeze0);
+        const float freeze1 = freeze_.advance(frozen_.load(std::memory_order_relaxed) ? 1.0f : 0.0f, step);
+        const float wet1 = wet_.advance(wet_target_.load(std::memory_order_relaxed), step);
+        const float dry1 = dry_.advance(dry_target_.load(std::memory_order_relaxed), step) * (1.0f - freeze1);
+        decay_.advance(decay_target_.load(std::memory_order_relaxed), step);
+        update_feedback();
+
+        const float in0 = 1.0f - freeze0;
+        const float d_in = (freeze0 - freeze1) / n;
+        const float d_wet = (wet1 - wet0) / n;
+        const float d_dry = (dry1 - dry0) / n;
+
+        // The freeze state is fixed for the whole block, so pick the kernel
+        // once here rather than testing it per sample
+        const bool frozen = (freeze0 >= 1.0f && freeze1 >= 1.0f);
+        const float *left = in_left + start * in_stride;
+        const float *right = in_right + start * in_stride;
+        float *left_out = out_left + start * out_stride;
+        float *right_out = out_right + start * out_stride;
+
+        // While the network sleeps only the dry signal is mixed. Input that
+        // the freeze lets through wakes it.
+        if (sleeping_) {
+            if (freeze0 >= 1.0f || input_energy(left, right, in_stride, n) < SILENCE_ENERGY * n) {
+                for (int i = 0; i < n; ++i) {
+                    const float dry_gain = dry0 + d_dry * i;
+                    left_out[i * out_stride] = (left[i * in_stride] * dry_gain) * MASTER_GAIN;
+                    right_out[i * out_stride] = (right[i * in_stride] * dry_gain) * MASTER_GAIN;
+                }
+                continue;
+            }
+            sleeping_ = false;
         }
 
-        if (frozen_) {
-            pre_left = pre_right = 0.0f;
+        if (lazy_clear_) {
+            clear_next(n);
         }
+        auto block = frozen ? &BasicReverb::process_block<true> : &BasicReverb::process_block<false>;
+        const float energy = (this->*block)(left, right, in_stride, left_out, right_out, out_stride,
+                                            n, kernels, in0, d_in, wet0, d_wet, dry0, d_dry);
 
-        // Comb filters
-        float wet_left = 0, wet_right = 0;
-        for (int j = 0; j < NUM_COMB; ++j) {
-            // Left channel
-            float delayed_l = combs_left_[j].buffer[combs_left_[j].index];
-            float feedback_l = delayed_l * combs_left_[j].feedback;
-            combs_left_[j].last = combs_left_[j].last * (1.0f - combs_left_[j].damp) + feedback_l * combs_left_[j].damp;
-            combs_left_[j].buffer[combs_left_[j].index] = pre_left + combs_left_[j].last;
-            if (++combs_left_[j].index >= combs_left_[j].buffer.size()) combs_left_[j].index = 0;
-            wet_left += delayed_l * COMB_GAIN[j];
+        // Once input and tail have stayed silent for long enough that
+        // nothing audible is left in the lines, put the network to sleep.
+        // The lines are cleared lazily, so waking up costs no more than a
+        // reset. A frozen tail never decays, so it is never put to sleep.
+        if (freeze0 <= 0.0f && freeze1 <= 0.0f && energy < SILENCE_ENERGY * n) {
+            quiet_frames_ += n;
+            if (quiet_frames_ >= tail_hold_) {
+                clear_lines(true);
+                quiet_frames_ = 0;
+                sleeping_ = true;
+            }
+        } else {
+            quiet_frames_ = 0;
+        }
+    }
+}
 
-            // Right channel
-            float delayed_r = combs_right_[j].buffer[combs_right_[j].index];
-            float feedback_r = delayed_r * combs_right_[j].feedback;
-            combs_right_[j].last = combs_right_[j].last * (1.0f - combs_right_[j].damp) + feedback_r * combs_right_[j].damp;
-            combs_right_[j].buffer[combs_right_[j].index] = pre_right + combs_right_[j].last;
-            if (++combs_right_[j].index >= combs_right_[j].buffer.size()) combs_right_[j].index = 0;
-            wet_right += delayed_r * COMB_GAIN[j];
+template <typename Topology>
+template <bool Frozen>
+float BasicReverb<Topology>::process_block(const float *left, const float *right, int in_stride,
+                                          float *left_out, float *right_out, int out_stride, int n,
+                                          const CombKernels &kernels, float in0, float d_in,
+                                          float wet0, float d_wet, float dry0, float d_dry) {
+    float wet_left[BLOCK], wet_right[BLOCK];
+    const int predelay_size = predelay_size_;
+    float energy = 0.0f;
+    if (n <= 0) {
+        return energy;
+    }
+
+    if constexpr (Frozen) {
+        // The muted input only writes zeros into the pre-delay. Once the
+        // whole line holds zeros, just keep its position moving.
+        if (predelay_silent_ < predelay_size) {
+            for (int i = 0; i < n; ++i) {
+                const int p = (predelay_index_ + i) % predelay_size;
+                predelay_[2 * p] = 0.0f;
+                predelay_[2 * p + 1] = 0.0f;
+            }
+            predelay_silent_ = std::min(predelay_size, predelay_silent_ + n);
+        }
+        predelay_index_ = (predelay_index_ + n) % predelay_size;
+
+        kernels.frozen(combs_, nullptr, nullptr, wet_left, wet_right, n);
+    } else {
+        // Pre-delay and input muting for freeze
+        float pre_left[BLOCK], pre_right[BLOCK];
+        for (int i = 0; i < n; ++i) {
+            const float in_gain = in0 + d_in * i;
+            float *slot = &predelay_[2 * predelay_index_];
+            pre_left[i] = slot[0] * in_gain;
+            pre_right[i] = slot[1] * in_gain;
+            const float l = left[i * in_stride];
+            const float r = right[i * in_stride];
+            energy += l * l + r * r;
+            slot[0] = l * in_gain;
+            slot[1] = r * in_gain;
+            if (++predelay_index_ >= predelay_size) {
+                predelay_index_ = 0;
+            }
         }
+        predelay_silent_ = 0;
+
+        // Comb filters, all lanes of both channels at once
+        kernels.process(combs_, pre_left, pre_right, wet_left, wet_right, n);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        float wl = wet_left[i];
+        float wr = wet_right[i];
 
         // All-pass filters
-        for (int j = 0; j < NUM_AP; ++j) {
+        for (int j = 0; j < kAllpasses; ++j) {
             // Left channel
             float delayed_l = allpasses_left_[j].buffer[allpasses_left_[j].index];
-            float output_l = delayed_l - wet_left * ALLPASS_GAIN;
-            allpasses_left_[j].buffer[allpasses_left_[j].index] = wet_left + output_l * ALLPASS_GAIN;
-            if (++allpasses_left_[j].index >= allpasses_left_[j].buffer.size()) allpasses_left_[j].index = 0;
-            wet_left = output_l;
+            float output_l = delayed_l - wl * ALLPASS_GAIN;
+            allpasses_left_[j].buffer[allpasses_left_[j].index] = wl + output_l * ALLPASS_GAIN;
+            if (++allpasses_left_[j].index >= allpasses_left_[j].size) allpasses_left_[j].index = 0;
+            wl = output_l;
 
             // Right channel
             float delayed_r = allpasses_right_[j].buffer[allpasses_right_[j].index];
-            float output_r = delayed_r - wet_right * ALLPASS_GAIN;
-            allpasses_right_[j].buffer[allpasses_right_[j].index] = wet_right + output_r * ALLPASS_GAIN;
-            if (++allpasses_right_[j].index >= allpasses_right_[j].buffer.size()) allpasses_right_[j].index = 0;
-            wet_right = output_r;
+            float output_r = delayed_r - wr * ALLPASS_GAIN;
+            allpasses_right_[j].buffer[allpasses_right_[j].index] = wr + output_r * ALLPASS_GAIN;
+            if (++allpasses_right_[j].index >= allpasses_right_[j].size) allpasses_right_[j].index = 0;
+            wr = output_r;
         }
+        energy += wl * wl + wr * wr;
 
-        // Mix and output, muting dry signal when frozen
-        float final_dry_left = frozen_ ? 0.0f : dry_left * DRY;
-        float final_dry_right = frozen_ ? 0.0f : dry_right * DRY;
-        in_left[i] = (final_dry_left + wet_left * WET) * MASTER_GAIN;
-        in_right[i] = (final_dry_right + wet_right * WET) * MASTER_GAIN;
+        // Mix and output, fading the dry signal out while frozen
+        const float wet_gain = wet0 + d_wet * i;
+        if constexpr (Frozen) {
+            left_out[i * out_stride] = (wl * wet_gain) * MASTER_GAIN;
+            right_out[i * out_stride] = (wr * wet_gain) * MASTER_GAIN;
+        } else {
+            const float dry_gain = dry0 + d_dry * i;
+            left_out[i * out_stride] = (left[i * in_stride] * dry_gain + wl * wet_gain) * MASTER_GAIN;
+            right_out[i * out_stride] = (right[i * in_stride] * dry_gain + wr * wet_gain) * MASTER_GAIN;
+        }
     }
+    return energy;
 }
+
+template class BasicReverb<Schroeder8x4>;
+template class BasicReverb<Schroeder4x2>;
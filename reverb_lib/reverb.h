@@ -1,49 +1,185 @@
 #ifndef REVERB_H
 #define REVERB_H
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <vector>
+#include <memory_resource>
 
-class Reverb {
+#include "comb_bank.h"
+#include "reverb_topology.h"
+
+// Stereo reverb with the comb/allpass network given by Topology (see
+// reverb_topology.h). The counts are compile-time constants, so per-line
+// state lives in fixed arrays and every loop over lines has a constant trip
+// count; all delay lines share one allocation made at construction.
+template <typename Topology>
+class BasicReverb {
 public:
-    Reverb(float sample_rate);
-    ~Reverb();
+    // The delay lines are allocated once, from `memory` when given (e.g. a
+    // std::pmr::monotonic_buffer_resource shared by many instances) and from
+    // the default memory resource otherwise. The resource must outlive the
+    // reverb. `delay_scale` stretches every comb and allpass line (not the
+    // pre-delay); instances with different scales give mutually
+    // decorrelated tails with the same decay times, e.g. for the channel
+    // pairs of a surround mix.
+    BasicReverb(float sample_rate, std::pmr::memory_resource *memory = nullptr,
+                float delay_scale = 1.0f);
+    ~BasicReverb();
+
+    BasicReverb(const BasicReverb &) = delete;
+    BasicReverb &operator=(const BasicReverb &) = delete;
+
+    // All processing runs with denormals flushed to zero. When the input and
+    // the tail have both stayed below -90 dBFS for long enough to have
+    // passed through the whole network, the network sleeps and only the dry
+    // signal is mixed until the input returns, so silence costs next to
+    // nothing.
 
+    // Processes planar buffers in place.
     void process(float *left, float *right, int num_samples);
+
+    // Processes interleaved stereo frames (L R L R ...). `in` may equal `out`.
+    void process_interleaved(const float *in, float *out, int num_frames);
+
+    // Reads and writes each channel with its own stride in samples, so the
+    // reverb can run directly on driver or file buffers of any layout, e.g.
+    // one channel pair of a multichannel interleaved stream. Input and
+    // output may alias sample for sample (in place).
+    void process_strided(const float *in_left, const float *in_right, int in_stride,
+                         float *out_left, float *out_right, int out_stride, int num_frames);
+
+    // Parameter setters are lock-free and may be called from any thread
+    // while another thread is inside process(). New values are picked up at
+    // the next block boundary; wet, dry, decay and freeze ramp to them over
+    // a few milliseconds instead of jumping.
     void set_enabled(bool enabled);
     void set_freeze(bool freeze_on);
+    void set_wet(float wet);      // wet level, default 0.5
+    void set_dry(float dry);      // dry level, default 0.5
+    void set_decay(float decay);  // decay time scale, default 1.0
+
+    // The comb network runs on the widest SIMD kernel the CPU supports
+    // (AVX, SSE2 or NEON). Passing false selects the scalar kernel, which
+    // produces identical output. Also safe to call while processing.
+    void set_simd(bool enabled);
+    const char *simd_name() const;
+
+    // Clears the tail and all filter state without reallocating, e.g. when
+    // switching files. Parameter settings are kept, and ramps jump to their
+    // targets. With `lazy`, the delay lines are zeroed a block at a time
+    // just ahead of where process() reads them, spreading the cost over the
+    // first pass through the longest line (about 0.3 s) instead of zeroing
+    // everything in this call.
+    //
+    // Unlike the setters, reset() and set_sample_rate() must not run
+    // concurrently with process().
+    void reset(bool lazy = false);
+
+    // Re-sizes the delay lines for a new rate, reusing the existing pool
+    // when they fit in it, then resets as above.
+    void set_sample_rate(float sample_rate, bool lazy = false);
+    float sample_rate() const { return sample_rate_; }
+
+    float delay_scale() const { return delay_scale_; }
 
 private:
-    struct Comb {
-        std::vector<float> buffer;
-        int index;
-        float feedback;
-        float damp;
-        float last;
-    };
+    static constexpr int kCombs = Topology::kCombs;
+    static constexpr int kAllpasses = Topology::kAllpasses;
+    using CombBank = reverb_detail::CombBank<kCombs>;
+    using CombKernels = reverb_detail::CombKernels<kCombs>;
+    static constexpr int kCombLanes = CombBank::kLanes;
 
+    // A delay line inside pool_
     struct Allpass {
-        std::vector<float> buffer;
+        float *buffer;
+        int size;
         int index;
     };
 
-    void init_filters();
+    // Moves a parameter toward its target by a bounded step per block
+    struct Ramp {
+        float value;
+        float advance(float target, float max_step);
+    };
+
+    void layout_lines();
+    void clear_lines(bool lazy);
+    void clear_next(int n);
+    void update_feedback();
+
+    // One block of at most BLOCK frames. The Frozen version runs only once
+    // the freeze ramp has completed: the input is muted and the dry signal
+    // is gone, so it skips the pre-delay and input paths and runs the combs
+    // on their recirculation kernel. Returns the summed energy of the input
+    // and the tail, for the silence detector.
+    template <bool Frozen>
+    float process_block(const float *left, const float *right, int in_stride, float *left_out,
+                       float *right_out, int out_stride, int n, const CombKernels &kernels,
+                       float in0, float d_in, float wet0, float d_wet, float dry0, float d_dry);
 
     float sample_rate_;
-    bool enabled_;
-    bool frozen_;
+    float delay_scale_;
+
+    // Targets written by the control thread
+    std::atomic<bool> enabled_;
+    std::atomic<bool> frozen_;
+    std::atomic<float> wet_target_;
+    std::atomic<float> dry_target_;
+    std::atomic<float> decay_target_;
+    static_assert(std::atomic<float>::is_always_lock_free, "parameters must be lock-free");
+
+    // Audio thread state
+    Ramp wet_;
+    Ramp dry_;
+    Ramp decay_;
+    Ramp freeze_;  // 0 = running, 1 = frozen
+    float ramp_step_;
+    float feedback_decay_;
+    float feedback_freeze_;
 
-    std::vector<Comb> combs_left_;
-    std::vector<Comb> combs_right_;
-    std::vector<Allpass> allpasses_left_;
-    std::vector<Allpass> allpasses_right_;
+    CombBank combs_;
+    std::atomic<const CombKernels *> comb_kernels_;
+    std::array<float, kCombLanes> feedback_exponent_;
+    std::array<float, kCombLanes> decay_feedback_;
 
-    std::vector<float> predelay_buffer_left_;
-    std::vector<float> predelay_buffer_right_;
+    std::array<Allpass, kAllpasses> allpasses_left_;
+    std::array<Allpass, kAllpasses> allpasses_right_;
+
+    float *predelay_;  // L/R interleaved, predelay_size_ frames
+    int predelay_size_;
     int predelay_index_;
+    int predelay_silent_;  // trailing samples known to be zero, up to the line length
+
+    // Backing store of every delay line, cache-line aligned and in the order
+    // process() walks them: pre-delay, then each left/right comb pair, then
+    // each left/right allpass pair. Every line starts on a cache line.
+    static constexpr size_t kPoolAlign = 64;
+    std::pmr::memory_resource *memory_;
+    float *pool_;
+    size_t pool_floats_;  // capacity
+    size_t pool_used_;    // floats in use at the current rate
+
+    // Lazy clearing: samples of each line's first lap still to be zeroed
+    bool lazy_clear_;
+    int predelay_stale_;
+    std::array<int, kCombLanes> comb_stale_;
+    std::array<int, kAllpasses> ap_stale_left_;
+    std::array<int, kAllpasses> ap_stale_right_;
 
-    std::vector<float> original_feedback_left_;
-    std::vector<float> original_feedback_right_;
+    // Silence detection: frames for a sample to pass through the network,
+    // frames of silent input and tail so far, and whether the network is
+    // currently bypassed
+    int tail_hold_;
+    int quiet_frames_;
+    bool sleeping_;
 };
 
+extern template class BasicReverb<Schroeder8x4>;
+extern template class BasicReverb<Schroeder4x2>;
+
+// The full network, as used by the tools and the GUI
+using Reverb = BasicReverb<Schroeder8x4>;
+
 #endif // REVERB_H
@@ -0,0 +1,43 @@
+#ifndef REVERB_TOPOLOGY_H
+#define REVERB_TOPOLOGY_H
+
+#include <array>
+
+// Reverb topologies for BasicReverb. Each one fixes at compile time how many
+// combs (per channel) and allpasses it runs, with their delay lengths at
+// 48 kHz, comb decay times (T60, seconds) and comb output gains. The lengths
+// are rescaled to the actual sample rate when a reverb is constructed.
+//
+// BasicReverb is explicitly instantiated for the topologies below in
+// reverb.cpp; a new topology needs a line there and, for its comb count, one
+// in comb_bank.cpp.
+
+// The original Schroeder-Moorer network of the firmware reverb
+struct Schroeder8x4 {
+    static constexpr int kCombs = 8;
+    static constexpr int kAllpasses = 4;
+
+    static constexpr std::array<int, kCombs> comb_delay_left = {509, 863, 1481, 2521, 4273, 7253, 10007, 15013};
+    static constexpr std::array<int, kCombs> comb_delay_right = {523, 877, 1489, 2531, 4283, 7283, 10037, 15031};
+    static constexpr std::array<float, kCombs> comb_t60 = {0.25f, 0.30f, 0.40f, 0.80f, 2.00f, 6.00f, 10.00f, 20.00f};
+    static constexpr std::array<float, kCombs> comb_gain = {0.62f, 0.60f, 0.58f, 0.55f, 0.52f, 0.50f, 0.48f, 0.45f};
+    static constexpr std::array<int, kAllpasses> allpass_delay_left = {142, 396, 1071, 3079};
+    static constexpr std::array<int, kAllpasses> allpass_delay_right = {145, 399, 1073, 3081};
+};
+
+// Half the combs and allpasses, for phones and small embedded hosts. Every
+// comb stands in for a pair of the full network, taking the longer delay and
+// decay of the pair; the gains are set so the wet level matches Schroeder8x4.
+struct Schroeder4x2 {
+    static constexpr int kCombs = 4;
+    static constexpr int kAllpasses = 2;
+
+    static constexpr std::array<int, kCombs> comb_delay_left = {863, 2521, 7253, 15013};
+    static constexpr std::array<int, kCombs> comb_delay_right = {877, 2531, 7283, 15031};
+    static constexpr std::array<float, kCombs> comb_t60 = {0.30f, 0.80f, 6.00f, 20.00f};
+    static constexpr std::array<float, kCombs> comb_gain = {0.86f, 0.80f, 0.72f, 0.66f};
+    static constexpr std::array<int, kAllpasses> allpass_delay_left = {396, 1071};
+    static constexpr std::array<int, kAllpasses> allpass_delay_right = {399, 1073};
+};
+
+#endif // REVERB_TOPOLOGY_H
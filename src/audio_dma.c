@@ -0,0 +1,164 @@
+/*
+ * DMA copies between the USB audio endpoint FIFOs and the ringbuffers
+ *
+ * The TinyUSB endpoint FIFOs are byte rings, so a packet occupies at most
+ * two spans of one; the wrap of the ringbuffer itself is handled by the DMA
+ * ring-wrap addressing. Every transfer is thus one channel per FIFO span,
+ * and the CPU only programs the channels.
+ *
+ * OUT packets are copied in the background: the two channels are chained,
+ * and the interrupt at the end of the last one frees the FIFO bytes and
+ * commits the samples to rx, which is what audio_task on the DSP core
+ * waits for. IN packets are different: TinyUSB queues whatever the FIFO
+ * holds as soon as tud_audio_tx_done_pre_load_cb returns, so the packet
+ * and its silence padding (read from a single zero word) are copied and
+ * waited for within the callback.
+ *
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "audio_dma.h"
+
+#if AUDIO_USE_DMA
+
+#include <stdbool.h>
+
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hot_path.h"
+#include "tusb.h"
+
+#define RING_BYTES_LOG2 (RINGBUF_CAPACITY_LOG2 + 2)
+_Static_assert(RING_BYTES_LOG2 <= 15, "DMA ring wrap covers at most 32 KiB");
+_Static_assert(CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ % sizeof(int32_t) == 0 &&
+                   CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ % sizeof(int32_t) == 0,
+               "endpoint FIFOs must wrap on whole samples");
+
+static ringbuffer_t *rx_ring;
+static ringbuffer_t *tx_ring;
+static uint rx_chan[2];
+static uint tx_chan;
+static volatile bool rx_busy;
+static uint16_t rx_bytes;  // size of the OUT transfer in flight
+static const uint32_t silence = 0;
+
+static inline uint16_t min_u16(uint16_t a, uint16_t b) { return (a < b) ? a : b; }
+
+// Address `offset` samples after `p` inside `rb`, wrapped
+static inline int32_t *ring_at(ringbuffer_t *rb, int32_t *p, size_t offset) {
+    return &rb->buffer[((size_t)(p - rb->buffer) + offset) & RINGBUF_MASK];
+}
+
+static void AUDIO_RAM_FUNC(rx_done_irq)(void) {
+    dma_hw->ints0 = (1u << rx_chan[0]) | (1u << rx_chan[1]);
+    tu_fifo_advance_read_pointer(tud_audio_get_ep_out_ff(), rx_bytes);
+    ringbuffer_commit_write(rx_ring, rx_bytes / sizeof(int32_t));
+    rx_busy = false;
+}
+
+void audio_dma_init(ringbuffer_t *rx, ringbuffer_t *tx) {
+    rx_ring = rx;
+    tx_ring = tx;
+    rx_chan[0] = (uint)dma_claim_unused_channel(true);
+    rx_chan[1] = (uint)dma_claim_unused_channel(true);
+    tx_chan = (uint)dma_claim_unused_channel(true);
+    irq_set_exclusive_handler(DMA_IRQ_0, rx_done_irq);
+    irq_set_enabled(DMA_IRQ_0, true);
+}
+
+void AUDIO_RAM_FUNC(audio_dma_rx_wait)(void) {
+    while (rx_busy)
+        tight_loop_contents();
+}
+
+// One FIFO span into the ring, chained to `next` (itself for none)
+static void AUDIO_RAM_FUNC(rx_configure)(uint chan, uint next, int32_t *dst, const void *src,
+                                         uint16_t bytes, bool trigger) {
+    dma_channel_config c = dma_channel_get_default_config(chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, RING_BYTES_LOG2);
+    channel_config_set_chain_to(&c, next);
+    dma_channel_set_irq0_enabled(chan, next == chan);
+    dma_channel_configure(chan, &c, dst, src, bytes / sizeof(int32_t), trigger);
+}
+
+void AUDIO_RAM_FUNC(audio_dma_rx)(uint16_t n_bytes) {
+    audio_dma_rx_wait();
+
+    tu_fifo_buffer_info_t info;
+    tu_fifo_get_read_info(tud_audio_get_ep_out_ff(), &info);
+    uint16_t lin = min_u16(info.len_lin, n_bytes);
+    uint16_t wrap = min_u16(info.len_wrap, (uint16_t)(n_bytes - lin));
+    if (lin == 0)
+        return;
+
+    size_t room;  // checked by the caller
+    int32_t *dst = ringbuffer_reserve_write(rx_ring, &room);
+    (void)room;
+    rx_bytes = (uint16_t)(lin + wrap);
+    rx_busy = true;
+    if (wrap > 0) {
+        rx_configure(rx_chan[1], rx_chan[1], ring_at(rx_ring, dst, lin / sizeof(int32_t)),
+                     info.ptr_wrap, wrap, false);
+        rx_configure(rx_chan[0], rx_chan[1], dst, info.ptr_lin, lin, true);
+    } else {
+        rx_configure(rx_chan[0], rx_chan[0], dst, info.ptr_lin, lin, true);
+    }
+}
+
+// `words` from the ring at `src`, or silence when src is NULL, to `dst`
+static void AUDIO_RAM_FUNC(tx_copy)(void *dst, const int32_t *src, size_t words) {
+    dma_channel_config c = dma_channel_get_default_config(tx_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, src != NULL);
+    channel_config_set_write_increment(&c, true);
+    if (src)
+        channel_config_set_ring(&c, false, RING_BYTES_LOG2);
+    dma_channel_configure(tx_chan, &c, dst, src ? (const void *)src : (const void *)&silence,
+                          (uint)words, true);
+    dma_channel_wait_for_finish_blocking(tx_chan);
+}
+
+void AUDIO_RAM_FUNC(audio_dma_tx)(size_t samples, size_t pad_samples) {
+    tu_fifo_t *ff = tud_audio_get_ep_in_ff();
+    tu_fifo_buffer_info_t info;
+    tu_fifo_get_write_info(ff, &info);
+
+    // Destination spans in samples; drop what does not fit
+    size_t lin = info.len_lin / sizeof(int32_t);
+    size_t wrap = info.len_wrap / sizeof(int32_t);
+    size_t total = samples + pad_samples;
+    if (total > lin + wrap)
+        total = lin + wrap;
+    if (samples > total)
+        samples = total;
+
+    size_t readable;  // at least `samples`, as counted by the caller
+    int32_t *src = ringbuffer_peek_read(tx_ring, &readable);
+    (void)readable;
+    size_t done = 0;
+    while (done < total) {
+        // Each run stays within one FIFO span and one source
+        uint8_t *dst = (done < lin) ? (uint8_t *)info.ptr_lin + done * sizeof(int32_t)
+                                    : (uint8_t *)info.ptr_wrap + (done - lin) * sizeof(int32_t);
+        size_t run = ((done < lin) ? lin : total) - done;
+        if (run > total - done)
+            run = total - done;
+        if (done < samples) {
+            if (run > samples - done)
+                run = samples - done;
+            tx_copy(dst, ring_at(tx_ring, src, done), run);
+        } else {
+            tx_copy(dst, NULL, run);
+        }
+        done += run;
+    }
+
+    tu_fifo_advance_write_pointer(ff, (uint16_t)(total * sizeof(int32_t)));
+    ringbuffer_release_read(tx_ring, samples);
+}
+
+#endif  // AUDIO_USE_DMA
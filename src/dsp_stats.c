@@ -0,0 +1,239 @@
+/*
+ * Per-block DSP cycle profiler
+ *
+ * fx_process is timed with the SysTick counter of the core that runs it,
+ * clocked from clk_sys, so the figures are CPU cycles. The recording side
+ * (core1) keeps min / max / sum and a histogram; the USB side (core0) reads
+ * a consistent copy through a sequence counter and never blocks audio.
+ * Telemetry frames use a second, shorter window of sum and max, which
+ * core0 asks core1 to restart after each frame the same way as a reset.
+ *
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "dsp_stats.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "hardware/structs/systick.h"
+#include "hot_path.h"
+#include "latency.h"
+
+#define SYSTICK_MASK 0x00FFFFFFu
+
+typedef struct {
+    uint32_t blocks;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t sum_cycles;
+    uint32_t hist[DSP_STATS_HIST_BINS];
+    uint32_t window_blocks;  // since the last telemetry frame
+    uint32_t window_max;
+    uint64_t window_sum;
+    uint32_t budget;  // set by dsp_stats_set_budget, kept across resets
+    uint32_t hist_shift;
+} dsp_record_t;
+
+static dsp_record_t rec;
+static atomic_uint seq;
+static atomic_bool reset_pending;
+static atomic_bool window_pending;
+static uint8_t telemetry_seq;
+
+static void record_clear(void) {
+    memset(&rec, 0, offsetof(dsp_record_t, budget));
+    rec.min_cycles = UINT32_MAX;
+}
+
+// Only this core writes `seq`, so plain stores suffice (the M0+ has no
+// atomic read-modify-write).
+static uint32_t record_write_begin(void) {
+    uint32_t s = atomic_load_explicit(&seq, memory_order_relaxed);
+    atomic_store_explicit(&seq, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return s;
+}
+
+static void record_write_end(uint32_t s) {
+    atomic_store_explicit(&seq, s + 2, memory_order_release);
+}
+
+static void window_clear(void) {
+    rec.window_blocks = 0;
+    rec.window_max = 0;
+    rec.window_sum = 0;
+}
+
+void dsp_stats_set_budget(uint32_t budget_cycles) {
+    // Bins span at least twice the budget so overload stays visible.
+    uint32_t shift = 0;
+    while (((uint32_t)DSP_STATS_HIST_BINS << shift) < 2 * budget_cycles)
+        shift++;
+    uint32_t s = record_write_begin();
+    rec.budget = budget_cycles;
+    rec.hist_shift = shift;
+    record_write_end(s);
+    atomic_store(&reset_pending, true);
+}
+
+void dsp_stats_init(uint32_t budget_cycles) {
+    systick_hw->rvr = SYSTICK_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+    record_clear();
+    dsp_stats_set_budget(budget_cycles);
+}
+
+uint32_t AUDIO_RAM_FUNC(dsp_stats_begin)(void) { return systick_hw->cvr; }
+
+void AUDIO_RAM_FUNC(dsp_stats_end)(uint32_t start) {
+    // SysTick counts down
+    uint32_t cycles = (start - systick_hw->cvr) & SYSTICK_MASK;
+    uint32_t bin = cycles >> rec.hist_shift;
+    if (bin >= DSP_STATS_HIST_BINS)
+        bin = DSP_STATS_HIST_BINS - 1;
+
+    uint32_t s = record_write_begin();
+    if (atomic_load_explicit(&reset_pending, memory_order_acquire)) {
+        atomic_store_explicit(&reset_pending, false, memory_order_relaxed);
+        record_clear();
+    }
+    if (atomic_load_explicit(&window_pending, memory_order_acquire)) {
+        atomic_store_explicit(&window_pending, false, memory_order_relaxed);
+        window_clear();
+    }
+    rec.blocks++;
+    rec.sum_cycles += cycles;
+    if (cycles < rec.min_cycles)
+        rec.min_cycles = cycles;
+    if (cycles > rec.max_cycles)
+        rec.max_cycles = cycles;
+    rec.hist[bin]++;
+    rec.window_blocks++;
+    rec.window_sum += cycles;
+    if (cycles > rec.window_max)
+        rec.window_max = cycles;
+    record_write_end(s);
+}
+
+void dsp_stats_reset(void) { atomic_store(&reset_pending, true); }
+
+static void record_copy(dsp_record_t *copy) {
+    uint32_t begin;
+    do {
+        begin = atomic_load_explicit(&seq, memory_order_acquire);
+        memcpy(copy, &rec, sizeof(*copy));
+        atomic_thread_fence(memory_order_acquire);
+    } while ((begin & 1) || begin != atomic_load_explicit(&seq, memory_order_relaxed));
+}
+
+void dsp_stats_snapshot(dsp_stats_t *s) {
+    dsp_record_t copy;
+    record_copy(&copy);
+
+    memset(s, 0, sizeof(*s));
+    s->blocks = copy.blocks;
+    s->budget_cycles = copy.budget;
+    s->hist_shift = copy.hist_shift;
+    if (copy.blocks > 0) {
+        s->min_cycles = copy.min_cycles;
+        s->max_cycles = copy.max_cycles;
+        s->avg_cycles = (uint32_t)(copy.sum_cycles / copy.blocks);
+    }
+    memcpy(s->hist, copy.hist, sizeof(s->hist));
+
+    uint32_t threshold = copy.blocks - copy.blocks / 100;
+    uint32_t cumulative = 0;
+    for (uint32_t i = 0; i < DSP_STATS_HIST_BINS && copy.blocks > 0; i++) {
+        cumulative += copy.hist[i];
+        if (cumulative >= threshold) {
+            uint32_t edge = (i + 1) << copy.hist_shift;
+            s->p99_cycles = (edge < copy.max_cycles) ? edge : copy.max_cycles;
+            break;
+        }
+    }
+
+    const latency_stats_t *lat = latency_get_stats();
+    s->underruns = lat->underruns;
+    s->overruns = lat->overruns;
+    s->resyncs = lat->resyncs;
+    s->fill_frames = lat->fill_frames;
+    s->target_frames = lat->target_frames;
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 5; i++) {
+        *p++ = v & 0x7F;
+        v >>= 7;
+    }
+    return p;
+}
+
+size_t dsp_stats_encode_sysex(uint8_t *buf, size_t size) {
+    if (size < DSP_STATS_SYSEX_MAX)
+        return 0;
+
+    dsp_stats_t s;
+    dsp_stats_snapshot(&s);
+
+    uint8_t *p = buf;
+    *p++ = 0xF0;
+    *p++ = DSP_SYSEX_MANUFACTURER;
+    *p++ = DSP_SYSEX_DEVICE;
+    *p++ = DSP_SYSEX_CMD_REPORT;
+    *p++ = DSP_SYSEX_VERSION;
+    const uint32_t *fields = (const uint32_t *)&s;
+    for (size_t i = 0; i < sizeof(s) / sizeof(uint32_t); i++)
+        p = put_u32(p, fields[i]);
+    *p++ = 0xF7;
+    return (size_t)(p - buf);
+}
+
+static uint8_t *put_u14(uint8_t *p, uint32_t v, bool wrap) {
+    if (!wrap && v > 0x3FFF)
+        v = 0x3FFF;
+    *p++ = v & 0x7F;
+    *p++ = (v >> 7) & 0x7F;
+    return p;
+}
+
+// Cycles as 0.1 % of the block budget
+static uint32_t permille(uint64_t cycles, uint32_t budget_cycles) {
+    return budget_cycles ? (uint32_t)(cycles * 1000 / budget_cycles) : 0;
+}
+
+size_t dsp_stats_encode_telemetry(uint8_t *buf, size_t size, uint8_t program,
+                                  uint32_t rx_frames, uint32_t tx_frames) {
+    if (size < DSP_TELEMETRY_SYSEX_LEN)
+        return 0;
+
+    dsp_record_t copy;
+    record_copy(&copy);
+    // Blocks ending between the copy and core1 seeing the request are
+    // dropped from the window, a few cycles out of a millisecond
+    atomic_store(&window_pending, true);
+    uint64_t avg = copy.window_blocks ? copy.window_sum / copy.window_blocks : 0;
+    const latency_stats_t *lat = latency_get_stats();
+
+    uint8_t *p = buf;
+    *p++ = 0xF0;
+    *p++ = DSP_SYSEX_MANUFACTURER;
+    *p++ = DSP_SYSEX_DEVICE;
+    *p++ = DSP_SYSEX_CMD_TELEMETRY;
+    *p++ = DSP_TELEMETRY_VERSION;
+    *p++ = telemetry_seq++ & 0x7F;
+    *p++ = program & 0x7F;
+    p = put_u14(p, permille(avg, copy.budget), false);
+    p = put_u14(p, permille(copy.window_max, copy.budget), false);
+    p = put_u14(p, rx_frames, false);
+    p = put_u14(p, tx_frames, false);
+    p = put_u14(p, lat->underruns, true);
+    p = put_u14(p, lat->overruns, true);
+    p = put_u14(p, lat->resyncs, true);
+    *p++ = 0xF7;
+    return (size_t)(p - buf);
+}
@@ -0,0 +1,159 @@
+/*
+ * Effect registry and chain
+ *
+ * Programs are fixed series of effects from the registry. fx_process runs
+ * the stages of the active program in place, so the chain needs no buffers
+ * of its own. A program change requested from core0 is picked up by core1
+ * at the next block boundary; effects that enter the chain are reset then,
+ * so they do not replay a stale tail from the last time they ran.
+ *
+ * Parameter changes are coalesced the same way: fx_set_param only records
+ * the latest value of each parameter and bumps its sequence number, and
+ * fx_process hands the parameters whose number moved to the effects once at
+ * the start of a block. A burst of Control Changes from a dragged slider
+ * thus costs the audio core one update per parameter and block, however
+ * many messages arrived.
+ *
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include <stdatomic.h>
+
+#include "fx.h"
+#include "hot_path.h"
+
+typedef struct {
+    const char *name;
+    const fx_t *stages[FX_CHAIN_MAX];
+    uint8_t count;
+} fx_program_t;
+
+static const fx_t *const registry[] = {&fx_reverb, &fx_reverb_q31, &fx_granular};
+#define REGISTRY_COUNT (sizeof(registry) / sizeof(registry[0]))
+
+// Program 0 is the power-on default, and its name is the USB product string.
+// Every program has at least one stage; the first one reads from the input.
+AUDIO_RAM_DATA static const fx_program_t programs[] = {
+    {"Pico USB Audio Loopback Reverb", {&fx_reverb}, 1},
+    {"Granular Freeze", {&fx_granular}, 1},
+    {"Granular Freeze > Reverb", {&fx_granular, &fx_reverb}, 2},
+    {"Reverb (24-bit)", {&fx_reverb_q31}, 1},
+};
+#define PROGRAM_COUNT (sizeof(programs) / sizeof(programs[0]))
+
+static atomic_uint requested_program;  // written by the control side
+static uint8_t active_program;         // owned by fx_process
+static atomic_uint running_program;    // active_program, published for core0
+
+// The enable switch (BOOTSEL button) follows the program: core0 stores the
+// wanted state, core1 hands it to the effects between blocks
+#define ENABLE_UNSET 2u
+static atomic_uint requested_enable = ENABLE_UNSET;
+static unsigned active_enable = ENABLE_UNSET;  // owned by fx_process
+
+/*
+ * Each side writes only its own words, so plain loads and stores suffice;
+ * the Cortex-M0+ has no exclusive accesses and a read-modify-write atomic
+ * would need libatomic's interrupt-masking fallback, which cannot guard
+ * against the other core. A value stored after core1 read the sequence
+ * number is picked up with it, then applied once more next block.
+ */
+static atomic_int_least16_t param_values[FX_PARAM_COUNT];  // latest value, written by core0
+static atomic_uint param_seq[FX_PARAM_COUNT];              // bumped by core0 after each value
+static unsigned applied_seq[FX_PARAM_COUNT];               // owned by fx_process
+
+static void AUDIO_RAM_FUNC(apply_params)(void) {
+    for (uint8_t id = 0; id < FX_PARAM_COUNT; ++id) {
+        unsigned seq = atomic_load_explicit(&param_seq[id], memory_order_acquire);
+        if (seq == applied_seq[id])
+            continue;
+        applied_seq[id] = seq;
+        int16_t val = (int16_t)atomic_load_explicit(&param_values[id], memory_order_relaxed);
+        for (size_t i = 0; i < REGISTRY_COUNT; ++i)
+            registry[i]->set_param(id, val);
+    }
+}
+
+static bool program_uses(const fx_program_t *p, const fx_t *fx) {
+    for (uint8_t i = 0; i < p->count; ++i) {
+        if (p->stages[i] == fx)
+            return true;
+    }
+    return false;
+}
+
+static void switch_program(uint8_t next) {
+    const fx_program_t *from = &programs[active_program];
+    const fx_program_t *to = &programs[next];
+    for (uint8_t i = 0; i < to->count; ++i) {
+        if (!program_uses(from, to->stages[i]))
+            to->stages[i]->init();
+    }
+    active_program = next;
+    atomic_store_explicit(&running_program, next, memory_order_release);
+}
+
+const char *fx_name(void) { return programs[0].name; }
+
+void fx_init(void) {
+    for (size_t i = 0; i < REGISTRY_COUNT; ++i)
+        registry[i]->init();
+    active_program = 0;
+    atomic_store_explicit(&running_program, 0, memory_order_release);
+    active_enable = ENABLE_UNSET;
+    atomic_store_explicit(&requested_program, 0, memory_order_relaxed);
+    for (uint8_t id = 0; id < FX_PARAM_COUNT; ++id)
+        applied_seq[id] = atomic_load_explicit(&param_seq[id], memory_order_relaxed);
+}
+
+void fx_set_format(uint8_t bit_rate, uint32_t sampling_rate) {
+    for (size_t i = 0; i < REGISTRY_COUNT; ++i)
+        registry[i]->set_format(bit_rate, sampling_rate);
+}
+
+void fx_set_enable(bool enable) {
+    atomic_store_explicit(&requested_enable, enable ? 1u : 0u, memory_order_release);
+}
+
+void fx_set_param(uint8_t id, int16_t val) {
+    if (id >= FX_PARAM_COUNT)
+        return;
+    atomic_store_explicit(&param_values[id], val, memory_order_relaxed);
+    // Only core0 writes param_seq, so a load and a store make the increment
+    unsigned seq = atomic_load_explicit(&param_seq[id], memory_order_relaxed);
+    atomic_store_explicit(&param_seq[id], seq + 1, memory_order_release);
+}
+
+size_t fx_program_count(void) { return PROGRAM_COUNT; }
+
+void fx_select_program(uint8_t program) {
+    if (program < PROGRAM_COUNT)
+        atomic_store_explicit(&requested_program, program, memory_order_release);
+}
+
+uint8_t fx_current_program(void) {
+    return (uint8_t)atomic_load_explicit(&running_program, memory_order_acquire);
+}
+
+const char *fx_program_name(uint8_t program) {
+    return (program < PROGRAM_COUNT) ? programs[program].name : NULL;
+}
+
+void AUDIO_RAM_FUNC(fx_process)(int32_t *out, int32_t *in, size_t frames) {
+    uint8_t requested = (uint8_t)atomic_load_explicit(&requested_program, memory_order_acquire);
+    if (requested != active_program)
+        switch_program(requested);
+    unsigned enable = atomic_load_explicit(&requested_enable, memory_order_acquire);
+    if (enable != active_enable) {
+        active_enable = enable;
+        for (size_t i = 0; i < REGISTRY_COUNT; ++i)
+            registry[i]->set_enable(enable != 0);
+    }
+    apply_params();
+
+    const fx_program_t *p = &programs[active_program];
+    p->stages[0]->process(out, in, frames);
+    for (uint8_t i = 1; i < p->count; ++i)
+        p->stages[i]->process(out, out, frames);
+}
@@ -19,6 +19,7 @@
 #include <string.h>
 
 #include "fx.h"
+#include "hot_path.h"
 
 // saturate to signed 16-bit
 static inline int16_t sat16(int32_t x) {
@@ -35,10 +36,15 @@ static inline int16_t sat16(int32_t x) {
 
 // Buffer and Grain settings
 #define BUFFER_SIZE (16384)
+#define BUFFER_MASK (BUFFER_SIZE - 1)
 #define NUM_GRAINS 8
 static int16_t grain_length = 2048;
 static int16_t grain_density = 8;
 #define GRAIN_FADE 512
+#define GRAIN_FADE_SHIFT 9
+
+_Static_assert((BUFFER_SIZE & BUFFER_MASK) == 0, "BUFFER_SIZE must be a power of two");
+_Static_assert((1 << GRAIN_FADE_SHIFT) == GRAIN_FADE, "GRAIN_FADE must be 1 << GRAIN_FADE_SHIFT");
 
 // Parameters
 static int16_t wet_mix = F32_Q15(0.5f);
@@ -46,7 +52,7 @@ static int16_t dry_mix = F32_Q15(0.5f);
 static bool freeze_enabled = false;
 
 // Buffer
-static int16_t buffer[BUFFER_SIZE];
+AUDIO_DSP_DATA("granular") static int16_t buffer[BUFFER_SIZE];
 static uint32_t write_pos = 0;
 
 // Grains
@@ -57,26 +63,46 @@ typedef struct {
 } grain_t;
 
 static grain_t grains[NUM_GRAINS];
+static uint32_t rng_state = 0x9E3779B9u;
+
+// xorshift32: cheap replacement for rand() in the grain scheduler
+static inline uint32_t rng_next(void) {
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng_state = x;
+    return x;
+}
+
+// Uniform value in [0, range) without a divide (range < 65536)
+static inline uint32_t rng_range(uint32_t range) { return ((rng_next() >> 16) * range) >> 16; }
+
+// Equal to F32_Q15((float)n / GRAIN_FADE) for 0 <= n <= GRAIN_FADE, in integer
+// arithmetic: n * 32767 is exact in a float, so the rounding matches.
+static inline int16_t fade_q15(uint32_t n) {
+    return (int16_t)((n * 32767u + (GRAIN_FADE / 2)) >> GRAIN_FADE_SHIFT);
+}
 
 // Initialize the effect
-void fx_init(void) {
+static void granular_init(void) {
     memset(buffer, 0, sizeof(buffer));
     for (int i = 0; i < NUM_GRAINS; i++) {
         grains[i].active = false;
     }
 }
 
-const char *fx_name(void) { return "Granular Freeze"; }
-
-void fx_set_format(uint8_t ch, uint32_t sr) {
+static void granular_set_format(uint8_t ch, uint32_t sr) {
     // No-op
+    (void)ch;
+    (void)sr;
 }
 
-void fx_set_enable(bool en) {
+static void granular_set_enable(bool en) {
     freeze_enabled = en;
 }
 
-void fx_set_param(uint8_t id, int16_t val) {
+static void granular_set_param(uint8_t id, int16_t val) {
     switch (id) {
         case FX_PARAM_WET_MIX:
             wet_mix = val;
@@ -86,52 +112,69 @@ void fx_set_param(uint8_t id, int16_t val) {
             break;
         case FX_PARAM_GRAIN_LENGTH:
             grain_length = 256 + (val >> 1); // Scale to a reasonable range
+            if (grain_length > BUFFER_SIZE - 1)
+                grain_length = BUFFER_SIZE - 1;
             break;
         case FX_PARAM_GRAIN_DENSITY:
             grain_density = 1 + (val >> 11); // Scale to a reasonable range (1-8)
+            if (grain_density > NUM_GRAINS)
+                grain_density = NUM_GRAINS;
             break;
         default:
             break;
     }
 }
 
-void fx_process(int32_t *out, int32_t *in, size_t frames) {
+// One block with the freeze state fixed. Both variants are inlined into
+// granular_process with `frozen` constant, so the per-sample recording
+// branch disappears; the frozen one never writes the buffer.
+static AUDIO_FORCE_INLINE void granular_block(int32_t *out, const int32_t *in, size_t frames,
+                                              const bool frozen) {
+    // Per-block constants. A negative fade-out start (grains shorter than
+    // GRAIN_FADE) means the grain only fades in.
+    const uint32_t length = (uint32_t)grain_length;
+    const int32_t fade_out_start = (int32_t)grain_length - GRAIN_FADE;
+    const uint32_t spawn_range = BUFFER_SIZE - length;
+    const int density = grain_density;
+    uint32_t wp = write_pos;
+
     for (size_t i = 0; i < frames; ++i) {
         int16_t in_l = in[2 * i] >> 16;
         int16_t in_r = in[2 * i + 1] >> 16;
 
         // Write to buffer (if not frozen)
-        if (!freeze_enabled) {
-            buffer[write_pos] = (in_l + in_r) >> 1; // Mono-ize
-            write_pos = (write_pos + 1) % BUFFER_SIZE;
+        if (!frozen) {
+            buffer[wp] = (in_l + in_r) >> 1; // Mono-ize
+            wp = (wp + 1) & BUFFER_MASK;
         }
 
         // Process grains
         int32_t wet_sample = 0;
-        for (int j = 0; j < grain_density; j++) {
-            if (grains[j].active) {
+        for (int j = 0; j < density; j++) {
+            grain_t *g = &grains[j];
+            if (g->active) {
                 // Envelope
+                uint32_t c = g->counter;
                 int16_t envelope = F32_Q15(1.0f);
-                if (grains[j].counter < GRAIN_FADE) {
-                    envelope = F32_Q15((float)grains[j].counter / GRAIN_FADE);
-                } else if (grains[j].counter > grain_length - GRAIN_FADE) {
-                    envelope = F32_Q15((float)(grain_length - grains[j].counter) / GRAIN_FADE);
+                if (c < GRAIN_FADE) {
+                    envelope = fade_q15(c);
+                } else if (fade_out_start >= 0 && c > (uint32_t)fade_out_start) {
+                    envelope = fade_q15(length - c);
                 }
 
                 // Read from buffer
-                uint32_t read_pos = (grains[j].pos + grains[j].counter) % BUFFER_SIZE;
-                wet_sample += FX_MUL(buffer[read_pos], envelope);
+                wet_sample += FX_MUL(buffer[(g->pos + c) & BUFFER_MASK], envelope);
 
                 // Increment counter and deactivate if finished
-                grains[j].counter++;
-                if (grains[j].counter >= grain_length) {
-                    grains[j].active = false;
+                g->counter = c + 1;
+                if (g->counter >= length) {
+                    g->active = false;
                 }
             } else {
                 // Activate a new grain
-                grains[j].active = true;
-                grains[j].counter = 0;
-                grains[j].pos = (write_pos + (rand() % (BUFFER_SIZE - grain_length))) % BUFFER_SIZE;
+                g->active = true;
+                g->counter = 0;
+                g->pos = (wp + rng_range(spawn_range)) & BUFFER_MASK;
             }
         }
 
@@ -144,4 +187,22 @@ void fx_process(int32_t *out, int32_t *in, size_t frames) {
         out[2 * i] = (int32_t)out_l << 16;
         out[2 * i + 1] = (int32_t)out_r << 16;
     }
+    write_pos = wp;
 }
+
+static void AUDIO_RAM_FUNC(granular_process)(int32_t *out, int32_t *in, size_t frames) {
+    // The freeze flag is written from the control core; sample it once
+    if (freeze_enabled)
+        granular_block(out, in, frames, true);
+    else
+        granular_block(out, in, frames, false);
+}
+
+AUDIO_RAM_DATA const fx_t fx_granular = {
+    .name = "Granular Freeze",
+    .init = granular_init,
+    .set_format = granular_set_format,
+    .set_enable = granular_set_enable,
+    .set_param = granular_set_param,
+    .process = granular_process,
+};
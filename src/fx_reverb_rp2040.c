@@ -5,20 +5,37 @@
  * combining parallel combs and series allpasses to achieve a natural-sounding
  * reverb tail with controllable decay time (T60) and diffusion characteristics.
  *
- * Buffers are dynamically allocated at init based on delay length arrays.
+ * All delay lines live in one static arena whose size is derived from the
+ * delay length tables at compile time, laid out in the order the block
+ * kernels walk them. Re-initialising only clears the arena.
+ *
+ * The tables hold lengths at REVERB_REF_RATE_HZ. fx_set_format rescales them
+ * to the stream rate and lays the arena out again; when the scaled lines do
+ * not fit (96 kHz in the host tools, with the default arena) they are
+ * shrunk uniformly to the largest size that does. Comb feedback is computed
+ * from the resulting delay in seconds, so the decay times hold at every
+ * rate.
  *
  * Category: Freeverb-style (Schroeder–Moorer algorithm)
  * Structure:
- *  - Pre-delay: circular buffer of PREDELAY_SAMPLES to separate dry hit
+ *  - Pre-delay: circular buffer of PREDELAY_SAMPLES (at the reference rate)
+ *      to separate dry hit
  *  - Comb filters: NUM_COMB parallel lowpass-feedback delay lines with
  *      • Delay lengths defined by COMB_DLY_L/R (prime numbers for diffusion)
  *      • Feedback coefficients computed for T60 times (comb_T60)
  *      • Damping (one-pole lowpass in feedback path)
  *  - Sum comb outputs to create dense early reflections and tail
  *  - Allpass filters: NUM_AP serial allpass delay lines for added diffusion
- *  - Dry/Wet mix: WET_Q15 / DRY_Q15 coefficients
+ *  - Dry/Wet mix: rev.wet / rev.dry, set with FX_PARAM_WET_MIX / FX_PARAM_DRY_MIX
  *  - Master gain: MASTER_GAIN_Q15 for output level
  *
+ * Two effects are exported from the same state. fx_reverb runs everything in
+ * Q15, so the 24-bit input is cut to 16 bits on the way in. fx_reverb_q31
+ * keeps the delay lines in 16 bits (they are most of the memory) but runs
+ * the dry path, the comb feedback filters, the comb sum and the mix in Q31
+ * with 32x32->64 (or 32x16->48) multiplies, so a 24-bit signal passes at
+ * full resolution and the tail does not decay through 16-bit truncation.
+ *
  * Copyright 2025, Hiroyuki OYAMA
  *
  * SPDX-License-Identifier: BSD-3-Clause
@@ -26,10 +43,10 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <stdlib.h>
 #include <string.h>
 
 #include "fx.h"
+#include "hot_path.h"
 
 // saturate to signed 16-bit
 static inline int16_t sat16(int32_t x) {
@@ -40,8 +57,8 @@ static inline int16_t sat16(int32_t x) {
     return (int16_t)x;
 }
 
-// Sample rate and sizes
-#define SR_HZ 48000u
+// Reference rate of the delay tables, and sizes
+#define REVERB_REF_RATE_HZ 48000u
 #define NUM_COMB 8
 #define NUM_AP 4
 #define PREDELAY_SAMPLES 960u
@@ -53,31 +70,61 @@ static inline int16_t sat16(int32_t x) {
 #define COMB_GAIN_Q15 F32_Q15(0.20f)
 #define AP_GAIN_Q15 F32_Q15(0.50f)
 #define MASTER_GAIN_Q15 F32_Q15(1.50f)
+#define F32_Q31(x) ((int32_t)((x) * 2147483647.0 + 0.5))
+
+// Delay lengths for comb and allpass as (left, right) pairs. The tables and
+// the arena size below are both generated from these lists.
+#define COMB_DELAYS(X) \
+    X(509, 523) X(863, 877) X(1481, 1489) X(2521, 2531) X(4273, 4283) X(7253, 7283) \
+    X(10007, 10037) X(15013, 15031)
+#define AP_DELAYS(X) X(142, 145) X(396, 399) X(1071, 1073) X(3079, 3081)
+
+#define DLY_L(l, r) l,
+#define DLY_R(l, r) r,
+#define DLY_SUM(l, r) +(l) + (r)
+#define DLY_COUNT(l, r) +1
+
+static const uint32_t COMB_DLY_L[NUM_COMB] = {COMB_DELAYS(DLY_L)};
+static const uint32_t COMB_DLY_R[NUM_COMB] = {COMB_DELAYS(DLY_R)};
+static const uint32_t AP_DLY_L[NUM_AP] = {AP_DELAYS(DLY_L)};
+static const uint32_t AP_DLY_R[NUM_AP] = {AP_DELAYS(DLY_R)};
 
-// Delay lengths for comb and allpass
-static const uint32_t COMB_DLY_L[NUM_COMB] = {509, 863, 1481, 2521, 4273, 7253, 10007, 15013};
-static const uint32_t COMB_DLY_R[NUM_COMB] = {523, 877, 1489, 2531, 4283, 7283, 10037, 15031};
-static const uint32_t AP_DLY_L[NUM_AP] = {142, 396, 1071, 3079};
-static const uint32_t AP_DLY_R[NUM_AP] = {145, 399, 1073, 3081};
+_Static_assert(0 COMB_DELAYS(DLY_COUNT) == NUM_COMB, "COMB_DELAYS must list NUM_COMB pairs");
+_Static_assert(0 AP_DELAYS(DLY_COUNT) == NUM_AP, "AP_DELAYS must list NUM_AP pairs");
+
+// Static arena for the pre-delay, comb and allpass lines of both channels,
+// sized for the full delay times at REVERB_ARENA_RATE_HZ. The USB stream
+// stops at AUDIO_MAX_SAMPLE_RATE, so the default fits every rate the device
+// offers; raise it to 96000 (about 380 KB) for the host tools' 96 kHz runs.
+#define REVERB_REF_SAMPLES (2 * PREDELAY_SAMPLES COMB_DELAYS(DLY_SUM) AP_DELAYS(DLY_SUM))
+#ifndef REVERB_ARENA_RATE_HZ
+#define REVERB_ARENA_RATE_HZ REVERB_REF_RATE_HZ
+#endif
+#define REVERB_ARENA_SAMPLES                                                              \
+    ((uint32_t)(((uint64_t)REVERB_REF_SAMPLES * REVERB_ARENA_RATE_HZ + REVERB_REF_RATE_HZ - 1) / \
+                REVERB_REF_RATE_HZ))
+#ifndef REVERB_ARENA_MAX_BYTES
+#define REVERB_ARENA_MAX_BYTES (192 * 1024)
+#endif
+_Static_assert(REVERB_ARENA_SAMPLES * sizeof(int16_t) <= REVERB_ARENA_MAX_BYTES,
+               "reverb delay lines exceed REVERB_ARENA_MAX_BYTES");
+AUDIO_DSP_DATA("reverb") static int16_t arena[REVERB_ARENA_SAMPLES];
 
 // Comb-specific parameters
 static const float comb_T60[NUM_COMB] = {0.25f, 0.30f, 0.40f, 0.80f, 2.00f, 6.00f, 10.00f, 20.00f};
-static const int16_t comb_gain[NUM_COMB] = {F32_Q15(0.62f), F32_Q15(0.60f), F32_Q15(0.58f),
-                                            F32_Q15(0.55f), F32_Q15(0.52f), F32_Q15(0.50f),
-                                            F32_Q15(0.48f), F32_Q15(0.45f)};
+AUDIO_RAM_DATA static const int16_t comb_gain[NUM_COMB] = {
+    F32_Q15(0.62f), F32_Q15(0.60f), F32_Q15(0.58f), F32_Q15(0.55f),
+    F32_Q15(0.52f), F32_Q15(0.50f), F32_Q15(0.48f), F32_Q15(0.45f)};
 
 // Allpass gain
 #define ALLPASS_GAIN AP_GAIN_Q15
 
-// Pre-delay buffers (static)
-static int16_t predL[PREDELAY_SAMPLES];
-static int16_t predR[PREDELAY_SAMPLES];
-
 // Filter structures
 typedef struct {
     int16_t *buf;
     uint32_t size, idx;
     int16_t fb, filt;
+    int32_t fb_q31, filt_q31;  // the same filter for fx_reverb_q31
 } comb_t;
 typedef struct {
     int16_t *buf;
@@ -89,10 +136,20 @@ typedef struct {
 typedef struct {
     comb_t L[NUM_COMB], R[NUM_COMB];
     ap_t AL[NUM_AP], AR[NUM_AP];
+    int16_t *predL, *predR;
+    int16_t wet, dry;
     bool enabled;
-    uint32_t pred_idx;
+    uint32_t pred_size, pred_idx;
+    uint32_t sample_rate;
 } reverb_t;
-static reverb_t rev;
+
+// Settings survive fx_init, so a chain program change keeps them
+static reverb_t rev = {
+    .wet = WET_Q15,
+    .dry = DRY_Q15,
+    .enabled = true,
+    .sample_rate = REVERB_REF_RATE_HZ,
+};
 
 // Helpers
 static inline int16_t to_q15(int32_t x) { return sat16(x >> 16); }
@@ -102,108 +159,367 @@ static inline int16_t mul_q15(int16_t a, int16_t b) {
     return sat16(p >> 15);
 }
 
-// Initialize filters and allocate buffers
+// Q31 helpers for fx_reverb_q31
+static inline int32_t sat32(int64_t x) {
+    if (x > INT32_MAX)
+        return INT32_MAX;
+    if (x < INT32_MIN)
+        return INT32_MIN;
+    return (int32_t)x;
+}
+static inline int32_t mul_q31(int32_t a, int32_t b) { return sat32(((int64_t)a * b) >> 31); }
+static inline int32_t mul_q31_q15(int32_t a, int16_t b) { return (int32_t)(((int64_t)a * b) >> 15); }
+// Rounds (a + b) / 2^16 to a Q15 delay line sample, without overflowing
+static inline int16_t store_q15(int32_t a, int32_t b) {
+    int32_t s = (a >> 1) + (b >> 1);
+    return sat16((s >> 15) + ((s >> 14) & 1));
+}
+
+static inline int16_t *arena_take(int16_t **next, uint32_t n) {
+    int16_t *line = *next;
+    *next += n;
+    return line;
+}
+
+// Delay length at the current rate: `ref` scaled by num / den, rounded to
+// nearest or down. Every line keeps at least one sample.
+static uint32_t scaled_len(uint32_t ref, uint32_t num, uint32_t den, bool round_down) {
+    uint64_t n = (uint64_t)ref * num + (round_down ? 0 : den / 2);
+    uint32_t len = (uint32_t)(n / den);
+    return len ? len : 1;
+}
+
+static uint32_t layout_total(uint32_t num, uint32_t den, bool round_down) {
+    uint32_t total = 2 * scaled_len(PREDELAY_SAMPLES, num, den, round_down);
+    for (uint32_t i = 0; i < NUM_COMB; ++i) {
+        total += scaled_len(COMB_DLY_L[i], num, den, round_down);
+        total += scaled_len(COMB_DLY_R[i], num, den, round_down);
+    }
+    for (uint32_t i = 0; i < NUM_AP; ++i) {
+        total += scaled_len(AP_DLY_L[i], num, den, round_down);
+        total += scaled_len(AP_DLY_R[i], num, den, round_down);
+    }
+    return total;
+}
+
+// Initialize filters and lay out the delay lines in the arena, in the order
+// process_block visits them: pre-delay, comb L/R pairs, allpass L/R pairs.
+// Lengths follow rev.sample_rate; wet/dry and the enable flag are kept.
 static void init_filters(void) {
-    // Allocate comb buffers and reset state
+    // Scale to the stream rate, or shrink to fit the arena. Rounding down
+    // with the arena/reference ratio never exceeds the arena.
+    uint32_t num = rev.sample_rate, den = REVERB_REF_RATE_HZ;
+    bool round_down = false;
+    if (layout_total(num, den, round_down) > REVERB_ARENA_SAMPLES) {
+        num = REVERB_ARENA_SAMPLES;
+        den = REVERB_REF_SAMPLES;
+        round_down = true;
+    }
+
+    memset(arena, 0, sizeof(arena));
+    int16_t *next = arena;
+    rev.pred_size = scaled_len(PREDELAY_SAMPLES, num, den, round_down);
+    rev.predL = arena_take(&next, rev.pred_size);
+    rev.predR = arena_take(&next, rev.pred_size);
+    // Comb lines and reset state
     for (uint32_t i = 0; i < NUM_COMB; ++i) {
-        rev.L[i].size = COMB_DLY_L[i];
-        rev.R[i].size = COMB_DLY_R[i];
-        rev.L[i].buf = calloc(rev.L[i].size, sizeof(int16_t));
-        rev.R[i].buf = calloc(rev.R[i].size, sizeof(int16_t));
+        rev.L[i].size = scaled_len(COMB_DLY_L[i], num, den, round_down);
+        rev.R[i].size = scaled_len(COMB_DLY_R[i], num, den, round_down);
+        rev.L[i].buf = arena_take(&next, rev.L[i].size);
+        rev.R[i].buf = arena_take(&next, rev.R[i].size);
         rev.L[i].idx = rev.R[i].idx = 0;
         rev.L[i].fb = rev.R[i].fb = 0;
         rev.L[i].filt = rev.R[i].filt = 0;
+        rev.L[i].filt_q31 = rev.R[i].filt_q31 = 0;
     }
     // Compute comb feedback gains
     const float MAX_FB = 0.98f;
     for (uint32_t i = 0; i < NUM_COMB; ++i) {
-        float g = powf(10.f, -3.f * COMB_DLY_L[i] / (float)SR_HZ / comb_T60[i]);
+        float g = powf(10.f, -3.f * rev.L[i].size / (float)rev.sample_rate / comb_T60[i]);
         if (g > MAX_FB)
             g = MAX_FB;
         rev.L[i].fb = rev.R[i].fb = (int16_t)(g * 32767.f + 0.5f);
+        rev.L[i].fb_q31 = rev.R[i].fb_q31 = F32_Q31(g);
     }
-    // Allocate allpass buffers and set gains
+    // Allpass lines and gains
     for (uint32_t i = 0; i < NUM_AP; ++i) {
-        rev.AL[i].size = AP_DLY_L[i];
-        rev.AR[i].size = AP_DLY_R[i];
-        rev.AL[i].buf = calloc(rev.AL[i].size, sizeof(int16_t));
-        rev.AR[i].buf = calloc(rev.AR[i].size, sizeof(int16_t));
+        rev.AL[i].size = scaled_len(AP_DLY_L[i], num, den, round_down);
+        rev.AR[i].size = scaled_len(AP_DLY_R[i], num, den, round_down);
+        rev.AL[i].buf = arena_take(&next, rev.AL[i].size);
+        rev.AR[i].buf = arena_take(&next, rev.AR[i].size);
         rev.AL[i].idx = rev.AR[i].idx = 0;
         rev.AL[i].g = rev.AR[i].g = ALLPASS_GAIN;
     }
-    // Initialize pre-delay and enable flag
     rev.pred_idx = 0;
-    rev.enabled = true;
 }
 
-// Comb processing with damping
-static inline int16_t comb_process(comb_t *c, int16_t x) {
-    int16_t d = c->buf[c->idx];
+// Comb processing with damping, over a block. The block is split at the
+// wrap point of the delay line so the inner loop runs without index checks.
+// Each comb output is scaled by `gain` and accumulated into `sum`.
+static void AUDIO_RAM_FUNC(comb_block)(comb_t *c, const int16_t *x, int32_t *sum, int16_t gain,
+                                       size_t n) {
     const int16_t DAMP_Q15 = F32_Q15(0.40f);
-    int32_t fb_term = (int32_t)c->fb * d;
-    int16_t fb_q15 = (int16_t)(fb_term >> 15);
-    c->filt = mul_q15(c->filt, sat16(F32_Q15(1.0f) - DAMP_Q15)) + mul_q15(fb_q15, DAMP_Q15);
-    int32_t w = (int32_t)x + c->filt;
-    c->buf[c->idx] = sat16(w);
-    if (++c->idx == c->size)
-        c->idx = 0;
-    return d;
-}
-
-// Allpass processing
-static inline int16_t ap_process(ap_t *a, int16_t x) {
-    int16_t d = a->buf[a->idx];
-    int16_t y = sat16((int32_t)d - mul_q15(x, a->g));
-    a->buf[a->idx] = sat16((int32_t)x + mul_q15(y, a->g));
-    if (++a->idx == a->size)
-        a->idx = 0;
-    return y;
-}
-
-// API functions
-const char *fx_name(void) { return "Pico USB Audio Loopback Reverb"; }
-void fx_init(void) { init_filters(); }
-void fx_set_format(uint8_t, uint32_t) { /* unused */ }
-void fx_set_enable(bool en) { rev.enabled = en; }
-
-// Main processing
-void fx_process(int32_t *out, int32_t *in, size_t frames) {
+    const int16_t ONE_MINUS_DAMP_Q15 = sat16(F32_Q15(1.0f) - DAMP_Q15);
+    const int16_t fb = c->fb;
+    int16_t filt = c->filt;
+    while (n > 0) {
+        uint32_t run = c->size - c->idx;
+        if (run > n)
+            run = (uint32_t)n;
+        int16_t *buf = &c->buf[c->idx];
+        for (uint32_t i = 0; i < run; ++i) {
+            int16_t d = buf[i];
+            int32_t fb_term = (int32_t)fb * d;
+            int16_t fb_q15 = (int16_t)(fb_term >> 15);
+            filt = mul_q15(filt, ONE_MINUS_DAMP_Q15) + mul_q15(fb_q15, DAMP_Q15);
+            buf[i] = sat16((int32_t)x[i] + filt);
+            sum[i] += mul_q15(d, gain);
+        }
+        c->idx += run;
+        if (c->idx == c->size)
+            c->idx = 0;
+        x += run;
+        sum += run;
+        n -= run;
+    }
+    c->filt = filt;
+}
+
+// comb_block for fx_reverb_q31: the filter runs in Q31 and only the line
+// is rounded to Q15. `sum` is Q27, for headroom over the NUM_COMB outputs.
+static void AUDIO_RAM_FUNC(comb_block_q31)(comb_t *c, const int16_t *x, int32_t *sum,
+                                           int16_t gain, size_t n) {
+    const int32_t DAMP_Q31 = F32_Q31(0.40f);
+    const int32_t fb = c->fb_q31;
+    int32_t filt = c->filt_q31;
+    while (n > 0) {
+        uint32_t run = c->size - c->idx;
+        if (run > n)
+            run = (uint32_t)n;
+        int16_t *buf = &c->buf[c->idx];
+        for (uint32_t i = 0; i < run; ++i) {
+            int16_t d = buf[i];
+            int32_t fb_term = mul_q31((int32_t)d << 16, fb);
+            // filt * (1 - damp) + fb_term * damp, with one multiply
+            filt += (int32_t)((((int64_t)fb_term - filt) * DAMP_Q31) >> 31);
+            buf[i] = store_q15((int32_t)x[i] << 16, filt);
+            sum[i] += ((int32_t)d * gain) >> 3;
+        }
+        c->idx += run;
+        if (c->idx == c->size)
+            c->idx = 0;
+        x += run;
+        sum += run;
+        n -= run;
+    }
+    c->filt_q31 = filt;
+}
+
+// Allpass processing, in place over a block
+static void AUDIO_RAM_FUNC(ap_block)(ap_t *a, int16_t *x, size_t n) {
+    const int16_t g = a->g;
+    while (n > 0) {
+        uint32_t run = a->size - a->idx;
+        if (run > n)
+            run = (uint32_t)n;
+        int16_t *buf = &a->buf[a->idx];
+        for (uint32_t i = 0; i < run; ++i) {
+            int16_t d = buf[i];
+            int16_t y = sat16((int32_t)d - mul_q15(x[i], g));
+            buf[i] = sat16((int32_t)x[i] + mul_q15(y, g));
+            x[i] = y;
+        }
+        a->idx += run;
+        if (a->idx == a->size)
+            a->idx = 0;
+        x += run;
+        n -= run;
+    }
+}
+
+// ap_block for fx_reverb_q31, on a Q31 signal
+static void AUDIO_RAM_FUNC(ap_block_q31)(ap_t *a, int32_t *x, size_t n) {
+    const int16_t g = a->g;
+    while (n > 0) {
+        uint32_t run = a->size - a->idx;
+        if (run > n)
+            run = (uint32_t)n;
+        int16_t *buf = &a->buf[a->idx];
+        for (uint32_t i = 0; i < run; ++i) {
+            int32_t d = (int32_t)buf[i] << 16;
+            int32_t y = sat32((int64_t)d - mul_q31_q15(x[i], g));
+            buf[i] = store_q15(x[i], mul_q31_q15(y, g));
+            x[i] = y;
+        }
+        a->idx += run;
+        if (a->idx == a->size)
+            a->idx = 0;
+        x += run;
+        n -= run;
+    }
+}
+
+// Pre-delay over a block: `x` is replaced by the delayed signal. Returns the
+// index after the block.
+static uint32_t AUDIO_RAM_FUNC(predelay_block)(int16_t *line, uint32_t size, uint32_t p,
+                                               int16_t *x, size_t n) {
+    while (n > 0) {
+        uint32_t run = size - p;
+        if (run > n)
+            run = (uint32_t)n;
+        for (uint32_t i = 0; i < run; ++i) {
+            int16_t d = line[p + i];
+            line[p + i] = x[i];
+            x[i] = d;
+        }
+        p += run;
+        if (p == size)
+            p = 0;
+        x += run;
+        n -= run;
+    }
+    return p;
+}
+
+// Effect interface
+static void reverb_init(void) { init_filters(); }
+// Re-fits the delay lines for a new stream rate. The tail is dropped, as it
+// would play back at the wrong pitch. Runs on the audio core, between blocks.
+static void reverb_set_format(uint8_t bit_rate, uint32_t sampling_rate) {
+    (void)bit_rate;
+    if (sampling_rate == 0 || sampling_rate == rev.sample_rate)
+        return;
+    rev.sample_rate = sampling_rate;
+    init_filters();
+}
+static void reverb_set_enable(bool en) { rev.enabled = en; }
+static void reverb_set_param(uint8_t id, int16_t val) {
+    switch (id) {
+        case FX_PARAM_WET_MIX:
+            rev.wet = val;
+            break;
+        case FX_PARAM_DRY_MIX:
+            rev.dry = val;
+            break;
+        default:
+            break;
+    }
+}
+
+// Block working buffers: fx_process handles at most BLOCK_FRAMES at a time
+#define BLOCK_FRAMES 64
+AUDIO_CORE1_DATA static int16_t dryL[BLOCK_FRAMES], dryR[BLOCK_FRAMES];
+AUDIO_CORE1_DATA static int16_t wetL[BLOCK_FRAMES], wetR[BLOCK_FRAMES];
+AUDIO_CORE1_DATA static int32_t sumL[BLOCK_FRAMES], sumR[BLOCK_FRAMES];
+
+static void AUDIO_RAM_FUNC(process_block)(int32_t *out, const int32_t *in, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dryL[i] = wetL[i] = to_q15(in[2 * i]);
+        dryR[i] = wetR[i] = to_q15(in[2 * i + 1]);
+        sumL[i] = sumR[i] = 0;
+    }
+    // Pre-delay (wetL/wetR now hold the pre-delayed input)
+    predelay_block(rev.predL, rev.pred_size, rev.pred_idx, wetL, n);
+    rev.pred_idx = predelay_block(rev.predR, rev.pred_size, rev.pred_idx, wetR, n);
+    // Comb network, one delay line at a time
+    for (uint32_t k = 0; k < NUM_COMB; ++k) {
+        comb_block(&rev.L[k], wetL, sumL, comb_gain[k], n);
+        comb_block(&rev.R[k], wetR, sumR, comb_gain[k], n);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        wetL[i] = sat16(sumL[i]);
+        wetR[i] = sat16(sumR[i]);
+    }
+    // Allpass network
+    for (uint32_t k = 0; k < NUM_AP; ++k) {
+        ap_block(&rev.AL[k], wetL, n);
+        ap_block(&rev.AR[k], wetR, n);
+    }
+    // Mix
+    const int16_t wet = rev.wet, dry = rev.dry;
+    for (size_t i = 0; i < n; ++i) {
+        int16_t mixL = sat16(mul_q15(dryL[i], dry) + mul_q15(wetL[i], wet));
+        int16_t mixR = sat16(mul_q15(dryR[i], dry) + mul_q15(wetR[i], wet));
+        out[2 * i] = from_q15(mul_q15(mixL, MASTER_GAIN_Q15));
+        out[2 * i + 1] = from_q15(mul_q15(mixR, MASTER_GAIN_Q15));
+    }
+}
+
+// process_block for fx_reverb_q31. Only the pre-delay input is rounded to
+// Q15; the dry signal is read from `in` at full resolution in the mix, and
+// sumL/sumR carry the wet signal through the allpasses in Q31.
+static void AUDIO_RAM_FUNC(process_block_q31)(int32_t *out, const int32_t *in, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        wetL[i] = store_q15(in[2 * i], 0);
+        wetR[i] = store_q15(in[2 * i + 1], 0);
+        sumL[i] = sumR[i] = 0;
+    }
+    predelay_block(rev.predL, rev.pred_size, rev.pred_idx, wetL, n);
+    rev.pred_idx = predelay_block(rev.predR, rev.pred_size, rev.pred_idx, wetR, n);
+    for (uint32_t k = 0; k < NUM_COMB; ++k) {
+        comb_block_q31(&rev.L[k], wetL, sumL, comb_gain[k], n);
+        comb_block_q31(&rev.R[k], wetR, sumR, comb_gain[k], n);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        sumL[i] = sat32((int64_t)sumL[i] << 4);
+        sumR[i] = sat32((int64_t)sumR[i] << 4);
+    }
+    for (uint32_t k = 0; k < NUM_AP; ++k) {
+        ap_block_q31(&rev.AL[k], sumL, n);
+        ap_block_q31(&rev.AR[k], sumR, n);
+    }
+    const int16_t wet = rev.wet, dry = rev.dry;
+    for (size_t i = 0; i < n; ++i) {
+        int32_t mixL = sat32((int64_t)mul_q31_q15(in[2 * i], dry) + mul_q31_q15(sumL[i], wet));
+        int32_t mixR = sat32((int64_t)mul_q31_q15(in[2 * i + 1], dry) + mul_q31_q15(sumR[i], wet));
+        out[2 * i] = mul_q31_q15(mixL, MASTER_GAIN_Q15);
+        out[2 * i + 1] = mul_q31_q15(mixR, MASTER_GAIN_Q15);
+    }
+}
+
+// Main processing, inlined into both effects with `q31` constant
+static AUDIO_FORCE_INLINE void reverb_run(int32_t *out, int32_t *in, size_t frames,
+                                          const bool q31) {
     if (!rev.enabled) {
         if (out != in)
             memcpy(out, in, frames * 8);
         return;
     }
-    for (size_t i = 0; i < frames; ++i) {
-        int16_t dryL = to_q15(in[2 * i]);
-        int16_t dryR = to_q15(in[2 * i + 1]);
-        // Pre-delay
-        int16_t preL = predL[rev.pred_idx];
-        int16_t preR = predR[rev.pred_idx];
-        predL[rev.pred_idx] = dryL;
-        predR[rev.pred_idx] = dryR;
-        if (++rev.pred_idx == PREDELAY_SAMPLES)
-            rev.pred_idx = 0;
-        // Comb network
-        int32_t sumL = 0, sumR = 0;
-        for (uint32_t k = 0; k < NUM_COMB; ++k) {
-            int16_t cL = mul_q15(comb_process(&rev.L[k], preL), comb_gain[k]);
-            int16_t cR = mul_q15(comb_process(&rev.R[k], preR), comb_gain[k]);
-            sumL += cL;
-            sumR += cR;
-        }
-        int16_t wetL = sat16(sumL);
-        int16_t wetR = sat16(sumR);
-        // Allpass network
-        for (uint32_t k = 0; k < NUM_AP; ++k) {
-            wetL = ap_process(&rev.AL[k], wetL);
-            wetR = ap_process(&rev.AR[k], wetR);
-        }
-        // Mix
-        int16_t mixL = sat16(mul_q15(dryL, DRY_Q15) + mul_q15(wetL, WET_Q15));
-        int16_t mixR = sat16(mul_q15(dryR, DRY_Q15) + mul_q15(wetR, WET_Q15));
-        int32_t outL = from_q15(mul_q15(mixL, MASTER_GAIN_Q15));
-        int32_t outR = from_q15(mul_q15(mixR, MASTER_GAIN_Q15));
-        out[2 * i] = outL;
-        out[2 * i + 1] = outR;
+    while (frames > 0) {
+        size_t n = (frames < BLOCK_FRAMES) ? frames : BLOCK_FRAMES;
+        if (q31)
+            process_block_q31(out, in, n);
+        else
+            process_block(out, in, n);
+        in += 2 * n;
+        out += 2 * n;
+        frames -= n;
     }
 }
+
+static void AUDIO_RAM_FUNC(reverb_process)(int32_t *out, int32_t *in, size_t frames) {
+    reverb_run(out, in, frames, false);
+}
+
+static void AUDIO_RAM_FUNC(reverb_process_q31)(int32_t *out, int32_t *in, size_t frames) {
+    reverb_run(out, in, frames, true);
+}
+
+AUDIO_RAM_DATA const fx_t fx_reverb = {
+    .name = "Pico USB Audio Loopback Reverb",
+    .init = reverb_init,
+    .set_format = reverb_set_format,
+    .set_enable = reverb_set_enable,
+    .set_param = reverb_set_param,
+    .process = reverb_process,
+};
+
+// Shares its state with fx_reverb, so only one of the two may be in a chain
+AUDIO_RAM_DATA const fx_t fx_reverb_q31 = {
+    .name = "Pico USB Audio Loopback Reverb (24-bit)",
+    .init = reverb_init,
+    .set_format = reverb_set_format,
+    .set_enable = reverb_set_enable,
+    .set_param = reverb_set_param,
+    .process = reverb_process_q31,
+};
@@ -0,0 +1,160 @@
+/*
+ * Adaptive latency control for the USB loopback path
+ *
+ * The OUT stream arrives at the host's clock and the IN stream is paced by
+ * the device, so the audio queued in rx_buffer + tx_buffer drifts over time.
+ * Instead of repeating or dropping whole frames when a ring runs dry or
+ * fills up, the number of frames sent in each IN packet is steered around
+ * the nominal rate / 1000 so the combined fill converges on a target depth.
+ *
+ * - Fill estimate: exponential moving average of the buffered frames (Q8),
+ *   which hides the 48-frame sawtooth of block processing.
+ * - Rate: nominal frames per 1 ms frame in Q16, plus a PI correction on the
+ *   fill error. The correction is clamped to 1/8 frame per packet so every
+ *   packet is nominal-1, nominal or nominal+1 frames (single-sample slip).
+ *
+ * With AUDIO_USE_FEEDBACK_EP the roles swap. The device clock is measured
+ * against the host's SOFs over windows of FB_WINDOW_FRAMES, IN packets are
+ * paced at that rate alone, and the PI correction goes into the explicit
+ * feedback value instead, so the host adjusts the OUT stream to the device.
+ *
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "latency.h"
+
+#include <stdbool.h>
+
+#include "audio_config.h"
+
+#define USB_SOF_HZ 1000
+#define FILL_EMA_SHIFT 5
+#define CORR_LIMIT_Q16 (1 << 13)  // 0.125 frame per packet
+#define KP_SHIFT 8                // 1/256 frame per packet for each frame of fill error
+#define KI_SHIFT 14               // integral gain, per packet and frame of error
+#define FB_WINDOW_FRAMES 1024     // USB frames per device clock measurement
+#define FB_FRAME_MASK 0x7FF       // SOF frame numbers are 11 bits
+
+static uint32_t sample_rate_hz = AUDIO_SAMPLE_RATE;
+static uint32_t nominal_q16;   // frames per USB frame, Q16.16
+static uint32_t phase_q16;     // fractional frame carried between packets
+static int32_t fill_q8;        // filtered buffered frames, Q24.8
+static int32_t integ_q16;      // integral term, frames per packet in Q16.16
+static int32_t target_q8;
+static uint32_t max_frames;
+static latency_stats_t stats;
+
+#if AUDIO_USE_FEEDBACK_EP
+// Owned by the SOF callback, apart from device_q16 which the IN callback
+// reads
+static volatile uint32_t device_q16;  // frames per USB frame at the device clock, Q16.16
+static uint32_t window_start_us;
+static uint32_t window_frames;
+static uint32_t last_frame;
+static bool window_open;
+#endif
+
+static inline int32_t clamp(int32_t x, int32_t lim) {
+    if (x > lim)
+        return lim;
+    if (x < -lim)
+        return -lim;
+    return x;
+}
+
+void latency_init(uint32_t sample_rate) {
+    sample_rate_hz = sample_rate;
+    nominal_q16 = (uint32_t)(((uint64_t)sample_rate << 16) / USB_SOF_HZ);
+    phase_q16 = 0;
+    integ_q16 = 0;
+
+    uint32_t target = (uint32_t)((uint64_t)sample_rate * AUDIO_TARGET_LATENCY_US / 1000000);
+    target_q8 = (int32_t)(target << 8);
+    fill_q8 = target_q8;
+    max_frames = (uint32_t)((uint64_t)sample_rate * AUDIO_MAX_LATENCY_US / 1000000);
+    stats.target_frames = target;
+    stats.fill_frames = target;
+#if AUDIO_USE_FEEDBACK_EP
+    device_q16 = nominal_q16;
+    window_open = false;
+#endif
+}
+
+uint32_t latency_sample_rate(void) { return sample_rate_hz; }
+
+// PI correction on the filtered fill, positive when more is queued than the
+// target
+static int32_t fill_correction_q16(size_t buffered_frames) {
+    fill_q8 += ((int32_t)(buffered_frames << 8) - fill_q8) >> FILL_EMA_SHIFT;
+    stats.fill_frames = (uint32_t)(fill_q8 >> 8);
+
+    // Error in frames, Q16.16 like the correction it drives
+    int32_t err_q16 = (fill_q8 - target_q8) * (1 << 8);
+    integ_q16 = clamp(integ_q16 + (err_q16 >> KI_SHIFT), CORR_LIMIT_Q16);
+    return clamp((err_q16 >> KP_SHIFT) + integ_q16, CORR_LIMIT_Q16);
+}
+
+uint32_t latency_next_packet_frames(size_t buffered_frames) {
+#if AUDIO_USE_FEEDBACK_EP
+    // The host follows the feedback, so the IN stream only keeps pace with
+    // the device clock.
+    (void)buffered_frames;
+    phase_q16 += device_q16;
+#else
+    // The target is what stays queued once this packet has gone; counting
+    // the packet itself would leave tx_buffer a block short of covering the
+    // next one. More queued than the target: send slightly more to drain it.
+    uint32_t nominal = nominal_q16 >> 16;
+    size_t left = (buffered_frames > nominal) ? buffered_frames - nominal : 0;
+    phase_q16 += (uint32_t)((int32_t)nominal_q16 + fill_correction_q16(left));
+#endif
+    uint32_t frames = phase_q16 >> 16;
+    phase_q16 &= 0xFFFF;
+    return frames;
+}
+
+#if AUDIO_USE_FEEDBACK_EP
+uint32_t latency_feedback_q16(uint32_t frame_number, uint32_t now_us, size_t buffered_frames) {
+    frame_number &= FB_FRAME_MASK;
+    if (!window_open) {
+        window_open = true;
+        window_start_us = now_us;
+        window_frames = 0;
+    } else {
+        // Count by frame number so a missed interrupt does not skew the window
+        window_frames += (frame_number - last_frame) & FB_FRAME_MASK;
+        if (window_frames >= FB_WINDOW_FRAMES) {
+            uint32_t elapsed_us = now_us - window_start_us;
+            uint32_t rate_q16 = (uint32_t)(((uint64_t)sample_rate_hz * elapsed_us << 16) /
+                                           ((uint64_t)window_frames * 1000000));
+            // A suspended or stalled bus gives a meaningless window; crystals
+            // stay far inside +-0.4 %
+            if (rate_q16 > nominal_q16 - (nominal_q16 >> 8) &&
+                rate_q16 < nominal_q16 + (nominal_q16 >> 8))
+                device_q16 = rate_q16;
+            window_start_us = now_us;
+            window_frames = 0;
+        }
+    }
+    last_frame = frame_number;
+
+    // More queued than the target: ask the host for slightly less.
+    return (uint32_t)((int32_t)device_q16 - fill_correction_q16(buffered_frames));
+}
+#endif
+
+size_t latency_excess_frames(size_t buffered_frames) {
+    if (buffered_frames <= max_frames)
+        return 0;
+    stats.resyncs++;
+    fill_q8 = target_q8;
+    integ_q16 = 0;
+    return buffered_frames - (size_t)(target_q8 >> 8);
+}
+
+void latency_count_underrun(void) { stats.underruns++; }
+
+void latency_count_overrun(void) { stats.overruns++; }
+
+const latency_stats_t *latency_get_stats(void) { return &stats; }
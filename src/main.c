@@ -7,74 +7,153 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "audio_dma.h"
 #include "bsp/board_api.h"
 #include "fx.h"
 #include "bootsel_button.h"
+#include "dsp_stats.h"
+#include "hot_path.h"
 #include "hardware/clocks.h"
+#include "hardware/timer.h"
+#include "latency.h"
 #include "led.h"
+#include "midi_control.h"
+#include "pico/multicore.h"
 #include "pico/stdlib.h"
 #include "ringbuffer.h"
 #include "tusb.h"
 #include "usb_descriptors.h"
 #include "fx.h"
 
-#define F32_Q15(x) ((int16_t)((x) * 32767.f + 0.5f))
+// When enabled, core0 only services USB/MIDI and core1 runs fx_process on
+// FRAME_LENGTH blocks. rx_buffer and tx_buffer are the single-producer /
+// single-consumer queues between the two cores.
+#ifndef AUDIO_DUAL_CORE
+#define AUDIO_DUAL_CORE 1
+#endif
 
 void midi_task(void);
 
-static ringbuffer_t rx_buffer = {0};
-static ringbuffer_t tx_buffer = {0};
+#if AUDIO_USE_DMA
+#define RINGBUF_ATTR AUDIO_DMA_RING_ALIGNED
+#else
+#define RINGBUF_ATTR
+#endif
+static ringbuffer_t rx_buffer RINGBUF_ATTR = {0};
+static ringbuffer_t tx_buffer RINGBUF_ATTR = {0};
 
-static int32_t scratch_in[64 * sizeof(int32_t) * 2];
-static int32_t scratch_out[64 * sizeof(int32_t) * 2];
-static uint64_t frac_acc = 0;
+static int32_t scratch_in[AUDIO_BLOCK_SAMPLES];
+static int32_t scratch_out[AUDIO_BLOCK_SAMPLES];
+// Owned by the USB callbacks on core0; never touched by audio_task.
+static int32_t usb_scratch[AUDIO_PACKET_MAX_SAMPLES];
 
-static int8_t silence_buf[AUDIO_FRAME_BYTES] = {0};
-static uint16_t current_sampling_rate = 48000;
-static const size_t FRAME_LENGTH = 48;
+static uint32_t current_sampling_rate = AUDIO_SAMPLE_RATE;
+static const size_t FRAME_LENGTH = AUDIO_BLOCK_FRAMES;
 
-#define FX_TIME_LOG_COUNT 1000
-#define UART_ID uart0
-#define BAUD_RATE 115200
-#define UART_TX_PIN 0
-#define UART_RX_PIN 1
+_Static_assert(CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX <= AUDIO_PACKET_MAX_BYTES,
+               "OUT endpoint packets must fit usb_scratch and the rx ring");
+_Static_assert(CFG_TUD_AUDIO_FUNC_1_EP_IN_SZ_MAX <= AUDIO_PACKET_MAX_BYTES,
+               "IN endpoint packets must fit usb_scratch");
 
-static uint32_t fx_time_samples[FX_TIME_LOG_COUNT];
-static int fx_time_index = 0;
-static bool fx_log_ready = false;
-static char scratch[1024];
+// Pending SysEx reply; drained across midi_task calls since the MIDI TX
+// FIFO is smaller than a stats report.
+static uint8_t sysex_tx[DSP_STATS_SYSEX_MAX];
+static size_t sysex_tx_len = 0;
+static size_t sysex_tx_pos = 0;
+static uint8_t sysex_rx[16];
+static size_t sysex_rx_len = 0;
 
-void audio_task(void) {
+// Telemetry streaming (DSP_SYSEX_CMD_STREAM): period in microseconds, 0 when
+// off, and the time the last frame was queued
+static uint32_t telemetry_period_us = 0;
+static uint32_t telemetry_last_us = 0;
+
+static uint32_t block_budget_cycles(uint32_t sampling_rate) {
+    return clock_get_hz(clk_sys) / sampling_rate * AUDIO_BLOCK_FRAMES;
+}
+
+void AUDIO_RAM_FUNC(audio_task)(void) {
     uint32_t sampling_rate;
     uint8_t bit_rate;
     uint8_t channels;
     usb_audio_get_config(&sampling_rate, &bit_rate, &channels);
     if (sampling_rate != current_sampling_rate) {
+        // The effects re-fit their delay lines here, on the audio core, so
+        // no fx_process call can see a half-updated layout.
         current_sampling_rate = sampling_rate;
+        fx_set_format(bit_rate, sampling_rate);
+        dsp_stats_set_budget(block_budget_cycles(sampling_rate));
         return;
     }
 
-    const size_t rx_samples = FRAME_LENGTH * 2;
-    const size_t frame_bytes = FRAME_LENGTH * sizeof(int32_t) * 2;
-    if (ringbuffer_size(&rx_buffer) >= rx_samples) {
+    // Process straight from rx_buffer into tx_buffer; scratch buffers are
+    // only used when a block straddles the wrap point of either ring.
+    const size_t rx_samples = AUDIO_BLOCK_SAMPLES;
+    if (ringbuffer_size(&rx_buffer) < rx_samples)
+        return;
+
+    size_t in_len, out_len;
+    int32_t *in = ringbuffer_peek_read(&rx_buffer, &in_len);
+    int32_t *out = ringbuffer_reserve_write(&tx_buffer, &out_len);
+    if (in_len < rx_samples) {
         ringbuffer_pop(&rx_buffer, scratch_in, rx_samples);
+        in = scratch_in;
+    }
+    if (out_len < rx_samples)
+        out = scratch_out;
 
-        fx_process(scratch_out, scratch_in, FRAME_LENGTH);
+    uint32_t t0 = dsp_stats_begin();
+    fx_process(out, in, FRAME_LENGTH);
+    dsp_stats_end(t0);
 
+    if (in != scratch_in)
+        ringbuffer_release_read(&rx_buffer, rx_samples);
+    if (out == scratch_out)
         ringbuffer_push(&tx_buffer, scratch_out, rx_samples);
-    }
+    else
+        ringbuffer_commit_write(&tx_buffer, rx_samples);
 }
 
 void led_task(void) { led_update(); }
 
+#if AUDIO_DUAL_CORE
+static void AUDIO_RAM_FUNC(core1_main)(void) {
+    dsp_stats_init(block_budget_cycles(current_sampling_rate));
+    while (1) {
+        audio_task();
+    }
+}
+#endif
+
 bool tud_audio_rx_done_pre_read_cb(uint8_t rhport, uint16_t n_bytes_received, uint8_t func_id,
                                    uint8_t ep_out, uint8_t cur_alt_setting) {
-    if (ringbuffer_capacity(&rx_buffer) == 0)
-        return true;
-    uint16_t rx_size = tud_audio_read(scratch_in, n_bytes_received);
-    if (rx_size != n_bytes_received)
+    size_t n = n_bytes_received / sizeof(int32_t);
+#if AUDIO_USE_DMA
+    // Let the previous packet land first, so the capacity is current
+    audio_dma_rx_wait();
+#endif
+    if (ringbuffer_capacity(&rx_buffer) < n) {
+        // Overrun: drop the packet so the FIFO does not back up.
+        latency_count_overrun();
+        tud_audio_read(usb_scratch, n_bytes_received);
         return true;
-    ringbuffer_push(&rx_buffer, scratch_in, rx_size / sizeof(int32_t));
+    }
+#if AUDIO_USE_DMA
+    audio_dma_rx(n_bytes_received);
+#else
+    // Read straight from the endpoint FIFO into the ring, in at most two
+    // pieces when the packet straddles the wrap point.
+    while (n > 0) {
+        size_t contiguous;
+        int32_t *dst = ringbuffer_reserve_write(&rx_buffer, &contiguous);
+        size_t chunk = (contiguous < n) ? contiguous : n;
+        uint16_t rx_size = tud_audio_read(dst, (uint16_t)(chunk * sizeof(int32_t)));
+        ringbuffer_commit_write(&rx_buffer, rx_size / sizeof(int32_t));
+        if (rx_size != chunk * sizeof(int32_t))
+            break;
+        n -= chunk;
+    }
+#endif
     return true;
 }
 
@@ -90,39 +169,71 @@ bool tud_audio_tx_done_pre_load_cb(uint8_t rhport, uint8_t itf, uint8_t ep_in,
     uint8_t channels;
     usb_audio_get_config(&sampling_rate, &bit_rate, &channels);
 
-    const uint32_t USB_SOF_HZ = 1000;
-    frac_acc += (uint64_t)current_sampling_rate;
-    uint32_t frames = frac_acc / USB_SOF_HZ;
-    frac_acc %= USB_SOF_HZ;
-    const size_t samples_needed = frames * channels;
-    if (samples_needed == 0)
-        return true;
+    if (sampling_rate != latency_sample_rate())
+        latency_init(sampling_rate);
 
-    size_t have = ringbuffer_size(&tx_buffer);
-    size_t to_copy = (have < samples_needed) ? have : samples_needed;
-    if (to_copy > 0) {
-        ringbuffer_pop(&tx_buffer, scratch_out, to_copy);
-    }
-    if (to_copy < samples_needed) {
-        if (to_copy >= channels && to_copy > 0) {
-            size_t last_frame_start = to_copy - channels;
-            for (size_t i = to_copy; i < samples_needed; i += channels) {
-                for (uint8_t ch = 0; ch < channels; ch++) {
-                    if (i + ch < samples_needed) {
-                        scratch_out[i + ch] = scratch_out[last_frame_start + ch];
-                    }
-                }
-            }
-        } else {
-            memset(scratch_out + to_copy, 0, (samples_needed - to_copy) * sizeof(int32_t));
+    size_t buffered = (ringbuffer_size(&rx_buffer) + ringbuffer_size(&tx_buffer)) / channels;
+    size_t excess = latency_excess_frames(buffered);
+    size_t have = ringbuffer_size(&tx_buffer) / channels;
+    if (excess > 0) {
+        // Far past the target (e.g. after a host stall): discard the oldest
+        // audio in one step so the latency stays bounded.
+        size_t drop = (excess < have) ? excess : have;
+        while (drop > 0) {
+            size_t contiguous;
+            ringbuffer_peek_read(&tx_buffer, &contiguous);
+            size_t chunk = (contiguous / channels < drop) ? contiguous / channels : drop;
+            ringbuffer_release_read(&tx_buffer, chunk * channels);
+            drop -= chunk;
+            have -= chunk;
         }
     }
 
-    tud_audio_write(scratch_out, (uint16_t)(samples_needed * sizeof(int32_t)));
+    uint32_t frames = latency_next_packet_frames(buffered);
+    if (frames == 0)
+        return true;
+
+    // The IN endpoint is asynchronous, so a packet one frame short is a
+    // legal rate slip. Anything shorter is an underrun and is padded with
+    // silence rather than repeated audio.
+    size_t to_send = (have < frames) ? have : frames;
+    size_t pad = (to_send + 1 >= frames) ? 0 : frames - to_send;
+    if (pad > 0)
+        latency_count_underrun();
+
+#if AUDIO_USE_DMA
+    audio_dma_tx(to_send * channels, pad * channels);
+#else
+    size_t left = to_send * channels;
+    while (left > 0) {
+        size_t contiguous;
+        int32_t *src = ringbuffer_peek_read(&tx_buffer, &contiguous);
+        size_t chunk = (contiguous < left) ? contiguous : left;
+        tud_audio_write(src, (uint16_t)(chunk * sizeof(int32_t)));
+        ringbuffer_release_read(&tx_buffer, chunk);
+        left -= chunk;
+    }
+    if (pad > 0) {
+        memset(usb_scratch, 0, pad * channels * sizeof(int32_t));
+        tud_audio_write(usb_scratch, (uint16_t)(pad * channels * sizeof(int32_t)));
+    }
+#endif
 
     return true;
 }
 
+#if AUDIO_USE_FEEDBACK_EP
+// Runs from tud_task on core0 after every SOF while the speaker interface
+// is open (see tud_sof_cb_enable in usb_descriptors.c). The delay between
+// the SOF and this call is loop jitter of a few tens of microseconds, small
+// against the one-second window that latency.c measures the clock over.
+void tud_sof_cb(uint32_t frame_count) {
+    size_t buffered =
+        (ringbuffer_size(&rx_buffer) + ringbuffer_size(&tx_buffer)) / AUDIO_NUM_CHANNELS;
+    tud_audio_fb_set(latency_feedback_q16(frame_count, time_us_32(), buffered));
+}
+#endif
+
 int main(void) {
     set_sys_clock_khz(240000, true);
 
@@ -132,27 +243,107 @@ int main(void) {
     board_init_after_tusb();
 
     fx_init();
+#if AUDIO_USE_DMA
+    audio_dma_init(&rx_buffer, &tx_buffer);
+#endif
     bb_init();
+    latency_init(current_sampling_rate);
+
+#if AUDIO_DUAL_CORE
+    multicore_launch_core1(core1_main);
+#else
+    dsp_stats_init(block_budget_cycles(current_sampling_rate));
+#endif
 
     while (1) {
         tud_task();
         midi_task();
+#if !AUDIO_DUAL_CORE
         audio_task();
+#endif
         led_task();
         fx_set_enable(bb_get_bootsel_button());
     }
 }
 
+static void sysex_handle(const uint8_t *msg, size_t len) {
+    // F0 <manufacturer> <device> <cmd> ... F7
+    if (len < 5 || msg[1] != DSP_SYSEX_MANUFACTURER || msg[2] != DSP_SYSEX_DEVICE)
+        return;
+    switch (msg[3]) {
+        case DSP_SYSEX_CMD_REQUEST:
+            if (sysex_tx_pos == sysex_tx_len) {
+                sysex_tx_len = dsp_stats_encode_sysex(sysex_tx, sizeof(sysex_tx));
+                sysex_tx_pos = 0;
+            }
+            break;
+        case DSP_SYSEX_CMD_RESET:
+            dsp_stats_reset();
+            break;
+        case DSP_SYSEX_CMD_STREAM:
+            if (len >= 6) {
+                telemetry_period_us = (uint32_t)msg[4] * 10000;
+                telemetry_last_us = time_us_32();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void sysex_collect(const uint8_t *data, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (data[i] == 0xF0)
+            sysex_rx_len = 0;
+        if (sysex_rx_len < sizeof(sysex_rx))
+            sysex_rx[sysex_rx_len++] = data[i];
+        if (data[i] == 0xF7) {
+            sysex_handle(sysex_rx, sysex_rx_len);
+            sysex_rx_len = 0;
+        }
+    }
+}
+
 void midi_task(void) {
+    // USB-MIDI event packets: byte 0 is cable number / code index number,
+    // bytes 1-3 are the MIDI message.
     uint8_t packet[4];
-    while (tud_midi_stream_read(packet, sizeof(packet))) {
+    while (tud_midi_packet_read(packet)) {
+        uint8_t cin = packet[0] & 0x0F;
+        if (cin == 0x4 || cin == 0x7) {  // SysEx start/continue, end with 3 bytes
+            sysex_collect(&packet[1], 3);
+            continue;
+        } else if (cin == 0x6) {  // SysEx end with 2 bytes
+            sysex_collect(&packet[1], 2);
+            continue;
+        } else if (cin == 0x5) {  // SysEx end with 1 byte
+            sysex_collect(&packet[1], 1);
+            continue;
+        }
+
         uint8_t msg_type = packet[1] & 0xF0;
-        uint8_t channel = packet[1] & 0x0F;
-        if (msg_type == 0xB0) { // Control Change
-            uint8_t controller = packet[2];
-            uint8_t value = packet[3];
-            int16_t q15_val = F32_Q15(value / 127.0f);
-            fx_set_param(controller, q15_val);
+        if (msg_type == 0xB0) { // Control Change, including NRPN
+            midi_control_change(packet[2], packet[3]);
+        } else if (msg_type == 0xC0) { // Program Change
+            fx_select_program(packet[2]);
         }
     }
+
+    // A telemetry frame goes out when it is due and nothing else is being
+    // sent, so a full report delays the next frame rather than interleaving
+    uint32_t now = time_us_32();
+    if (telemetry_period_us > 0 && now - telemetry_last_us >= telemetry_period_us &&
+        sysex_tx_pos == sysex_tx_len) {
+        telemetry_last_us = now;
+        sysex_tx_len = dsp_stats_encode_telemetry(
+            sysex_tx, sizeof(sysex_tx), fx_current_program(),
+            (uint32_t)(ringbuffer_size(&rx_buffer) / AUDIO_NUM_CHANNELS),
+            (uint32_t)(ringbuffer_size(&tx_buffer) / AUDIO_NUM_CHANNELS));
+        sysex_tx_pos = 0;
+    }
+
+    if (sysex_tx_pos < sysex_tx_len) {
+        sysex_tx_pos += tud_midi_stream_write(0, &sysex_tx[sysex_tx_pos],
+                                              (uint32_t)(sysex_tx_len - sysex_tx_pos));
+    }
 }
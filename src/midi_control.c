@@ -0,0 +1,83 @@
+/*
+ * MIDI Control Change and NRPN decoding
+ *
+ * Runs on core0 for every incoming CC, so it only does table lookups and
+ * integer arithmetic; the soft-float divide per message of the old
+ * F32_Q15(value / 127.0f) is gone. The values then go through fx_set_param,
+ * which keeps the latest one per parameter for the audio core.
+ *
+ * Copyright 2025, Hiroyuki OYAMA
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "midi_control.h"
+
+#include <stdbool.h>
+
+#include "fx.h"
+
+#define CC_DATA_ENTRY_MSB 6
+#define CC_DATA_ENTRY_LSB 38
+#define CC_NRPN_LSB 98
+#define CC_NRPN_MSB 99
+#define CC_RPN_LSB 100
+#define CC_RPN_MSB 101
+
+// round(v * 32767 / 127) in integers, which matches the float conversion
+#define CC_Q15(v) (int16_t)(((v) * 32767 * 2 + 127) / 254)
+#define CC_Q15_4(v) CC_Q15(v), CC_Q15((v) + 1), CC_Q15((v) + 2), CC_Q15((v) + 3)
+#define CC_Q15_16(v) CC_Q15_4(v), CC_Q15_4((v) + 4), CC_Q15_4((v) + 8), CC_Q15_4((v) + 12)
+
+static const int16_t cc_q15[128] = {
+    CC_Q15_16(0),  CC_Q15_16(16), CC_Q15_16(32), CC_Q15_16(48),
+    CC_Q15_16(64), CC_Q15_16(80), CC_Q15_16(96), CC_Q15_16(112),
+};
+
+// NRPN state. The parameter number starts out as the null NRPN (127, 127).
+static uint8_t nrpn_msb = 127;
+static uint8_t nrpn_lsb = 127;
+static uint8_t data_msb = 0;
+static bool nrpn_selected = false;
+
+int16_t midi_cc_to_q15(uint8_t value) { return cc_q15[value & 0x7F]; }
+
+int16_t midi_nrpn_to_q15(uint16_t value) {
+    if (value > 16383)
+        value = 16383;
+    return (int16_t)(((uint32_t)value * 32767 * 2 + 16383) / 32766);
+}
+
+static void nrpn_apply(uint16_t value) {
+    uint16_t param = (uint16_t)((nrpn_msb << 7) | nrpn_lsb);
+    if (nrpn_selected && param < FX_PARAM_COUNT)
+        fx_set_param((uint8_t)param, midi_nrpn_to_q15(value));
+}
+
+void midi_control_change(uint8_t controller, uint8_t value) {
+    value &= 0x7F;
+    switch (controller) {
+        case CC_NRPN_MSB:
+            nrpn_msb = value;
+            nrpn_selected = true;
+            break;
+        case CC_NRPN_LSB:
+            nrpn_lsb = value;
+            nrpn_selected = true;
+            break;
+        case CC_RPN_MSB:
+        case CC_RPN_LSB:
+            nrpn_selected = false;
+            break;
+        case CC_DATA_ENTRY_MSB:
+            data_msb = value;
+            nrpn_apply((uint16_t)(value << 7));
+            break;
+        case CC_DATA_ENTRY_LSB:
+            nrpn_apply((uint16_t)((data_msb << 7) | value));
+            break;
+        default:
+            if (controller < FX_PARAM_COUNT)
+                fx_set_param(controller, cc_q15[value]);
+            break;
+    }
+}
@@ -2,48 +2,79 @@
 
 #include <string.h>
 
-#define RINGBUF_CAPACITY (RINGBUF_FRAMES * AUDIO_FRAME_BYTES / sizeof(int32_t))
+#include "hot_path.h"
 
-static inline size_t rb_wrap(size_t idx) { return (idx % RINGBUF_CAPACITY); }
+static inline size_t rb_contiguous(size_t idx, size_t n) {
+    size_t to_end = RINGBUF_CAPACITY - (idx & RINGBUF_MASK);
+    return (to_end < n) ? to_end : n;
+}
+
+size_t AUDIO_RAM_FUNC(ringbuffer_size)(ringbuffer_t *rb) {
+    size_t w = atomic_load_explicit(&rb->write, memory_order_acquire);
+    size_t r = atomic_load_explicit(&rb->read, memory_order_acquire);
+    return w - r;
+}
+
+size_t AUDIO_RAM_FUNC(ringbuffer_capacity)(ringbuffer_t *rb) {
+    return RINGBUF_CAPACITY - ringbuffer_size(rb);
+}
+
+int32_t *AUDIO_RAM_FUNC(ringbuffer_reserve_write)(ringbuffer_t *rb, size_t *n) {
+    size_t w = atomic_load_explicit(&rb->write, memory_order_relaxed);
+    size_t r = atomic_load_explicit(&rb->read, memory_order_acquire);
+    *n = rb_contiguous(w, RINGBUF_CAPACITY - (w - r));
+    return &rb->buffer[w & RINGBUF_MASK];
+}
+
+void AUDIO_RAM_FUNC(ringbuffer_commit_write)(ringbuffer_t *rb, size_t n) {
+    size_t w = atomic_load_explicit(&rb->write, memory_order_relaxed);
+    atomic_store_explicit(&rb->write, w + n, memory_order_release);
+}
 
-size_t ringbuffer_size(ringbuffer_t *rb) {
-    size_t r = rb->read;
-    size_t w = rb->write;
-    return (w >= r) ? (w - r) : (RINGBUF_CAPACITY - (r - w));
+int32_t *AUDIO_RAM_FUNC(ringbuffer_peek_read)(ringbuffer_t *rb, size_t *n) {
+    size_t r = atomic_load_explicit(&rb->read, memory_order_relaxed);
+    size_t w = atomic_load_explicit(&rb->write, memory_order_acquire);
+    *n = rb_contiguous(r, w - r);
+    return &rb->buffer[r & RINGBUF_MASK];
 }
 
-size_t ringbuffer_capacity(ringbuffer_t *rb) {
-    return (RINGBUF_CAPACITY - 1) - ringbuffer_size(rb);
+void AUDIO_RAM_FUNC(ringbuffer_release_read)(ringbuffer_t *rb, size_t n) {
+    size_t r = atomic_load_explicit(&rb->read, memory_order_relaxed);
+    atomic_store_explicit(&rb->read, r + n, memory_order_release);
 }
 
-bool ringbuffer_push(ringbuffer_t *rb, int32_t *src, size_t n) {
+bool AUDIO_RAM_FUNC(ringbuffer_push)(ringbuffer_t *rb, int32_t *src, size_t n) {
     if (n == 0 || n > ringbuffer_capacity(rb))
         return false;
 
-    size_t w = rb->write;
-    size_t first = (RINGBUF_CAPACITY - w) < n ? (RINGBUF_CAPACITY - w) : n;
-    memcpy(&rb->buffer[w], src, first * sizeof(int32_t));
+    size_t first;
+    int32_t *dst = ringbuffer_reserve_write(rb, &first);
+    if (first > n)
+        first = n;
+    memcpy(dst, src, first * sizeof(int32_t));
 
     size_t remain = n - first;
     if (remain)
         memcpy(&rb->buffer[0], src + first, remain * sizeof(int32_t));
 
-    rb->write = rb_wrap(w + n);
+    ringbuffer_commit_write(rb, n);
     return true;
 }
 
-bool ringbuffer_pop(ringbuffer_t *rb, int32_t *dst, size_t n) {
+bool AUDIO_RAM_FUNC(ringbuffer_pop)(ringbuffer_t *rb, int32_t *dst, size_t n) {
     if (n == 0 || n > ringbuffer_size(rb))
         return false;
 
-    size_t r = rb->read;
-    size_t first = (RINGBUF_CAPACITY - r) < n ? (RINGBUF_CAPACITY - r) : n;
-    memcpy(dst, &rb->buffer[r], first * sizeof(int32_t));
+    size_t first;
+    const int32_t *src = ringbuffer_peek_read(rb, &first);
+    if (first > n)
+        first = n;
+    memcpy(dst, src, first * sizeof(int32_t));
 
     size_t remain = n - first;
     if (remain)
         memcpy(dst + first, &rb->buffer[0], remain * sizeof(int32_t));
 
-    rb->read = rb_wrap(r + n);
+    ringbuffer_release_read(rb, n);
     return true;
 }
@@ -19,6 +19,7 @@
 #define EPNUM_AUDIO_IN 0x01
 #define EPNUM_AUDIO_OUT 0x01
 #define EPNUM_AUDIO_INT 0x02
+#define EPNUM_AUDIO_FB 0x03
 
 enum {
     STRID_LANGID = 0,
@@ -49,7 +50,8 @@ uint8_t const desc_configuration[] = {
     // Config number, interface count, string index, total length, attribute, power in mA
     TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0x00, 100),
     // Interface number, string index, EP Out & EP In address, EP size
-    TUD_AUDIO_INTERFACE_STEREO_DESCRIPTOR(4, EPNUM_AUDIO_OUT, EPNUM_AUDIO_IN | 0x80, EPNUM_AUDIO_INT | 0x80),
+    TUD_AUDIO_INTERFACE_STEREO_DESCRIPTOR(4, EPNUM_AUDIO_OUT, EPNUM_AUDIO_IN | 0x80, EPNUM_AUDIO_INT | 0x80,
+                                          EPNUM_AUDIO_FB | 0x80),
     TUD_MIDI_DESCRIPTOR(ITF_NUM_MIDI, 5, EPNUM_MIDI_OUT, EPNUM_MIDI_IN | 0x80, 64)
 };
 
@@ -64,10 +66,9 @@ char const *string_desc_arr[] = {
 
 static uint16_t _desc_str[32 + 1];
 
-// static const uint32_t supported_sample_rates[] = {44100, 48000};
-static const uint32_t supported_sample_rates[] = {48000};
+static const uint32_t supported_sample_rates[] = {AUDIO_SAMPLE_RATES};
 
-static uint32_t current_sample_rate = 48000;
+static uint32_t current_sample_rate = AUDIO_SAMPLE_RATE;
 #define N_SAMPLE_RATES TU_ARRAY_SIZE(supported_sample_rates)
 static uint8_t current_bit_rate = 24;
 
@@ -186,8 +187,15 @@ static bool tud_audio_clock_set_request(uint8_t rhport, audio_control_request_t
     if (request->bControlSelector == AUDIO_CS_CTRL_SAM_FREQ) {
         TU_VERIFY(request->wLength == sizeof(audio_control_cur_4_t));
 
-        current_sample_rate = (uint32_t)((audio_control_cur_4_t const *)buf)->bCur;
-        return true;
+        uint32_t rate = (uint32_t)tu_le32toh(((audio_control_cur_4_t const *)buf)->bCur);
+        for (size_t i = 0; i < N_SAMPLE_RATES; i++) {
+            if (supported_sample_rates[i] == rate) {
+                current_sample_rate = rate;
+                return true;
+            }
+        }
+        TU_LOG1("Unsupported sample rate %lu\r\n", (unsigned long)rate);
+        return false;
     } else {
         TU_LOG1("Clock set request not supported, entity = %u, selector = %u, request = %u\r\n",
                 request->bEntityID, request->bControlSelector, request->bRequest);
@@ -221,11 +229,41 @@ bool tud_audio_set_itf_cb(uint8_t rhport, tusb_control_request_t const *p_reques
     uint8_t const itf = tu_u16_low(tu_le16toh(p_request->wIndex));
     uint8_t const alt = tu_u16_low(tu_le16toh(p_request->wValue));
 
-    if (ITF_NUM_AUDIO_STREAMING_SPK == itf && alt != 0)
+    if (ITF_NUM_AUDIO_STREAMING_SPK == itf && alt != 0) {
         led_set_blink_interval(BLINK_STREAMING);
+#if AUDIO_USE_FEEDBACK_EP
+        tud_sof_cb_enable(true);
+#endif
+    }
 
     if (alt != 0) {
         current_bit_rate = CFG_TUD_AUDIO_FUNC_1_FORMAT_1_RESOLUTION_RX;
     }
     return true;
 }
+
+#if AUDIO_USE_FEEDBACK_EP
+// Invoked for alt 0 as well, unlike tud_audio_set_itf_cb
+bool tud_audio_set_itf_close_EP_cb(uint8_t rhport, tusb_control_request_t const *p_request) {
+    (void)rhport;
+    uint8_t const itf = tu_u16_low(tu_le16toh(p_request->wIndex));
+    uint8_t const alt = tu_u16_low(tu_le16toh(p_request->wValue));
+
+    if (ITF_NUM_AUDIO_STREAMING_SPK == itf && alt == 0)
+        tud_sof_cb_enable(false);
+    return true;
+}
+
+// The feedback value is computed from the ringbuffer fill against the
+// device clock (tud_sof_cb in main.c), not from the endpoint FIFO, which is
+// emptied on every packet. TinyUSB's own estimate stays off, and with it the
+// class's SOF handling, so the SOFs reach tud_sof_cb through
+// tud_sof_cb_enable instead.
+void tud_audio_feedback_params_cb(uint8_t func_id, uint8_t alt_itf,
+                                  audio_feedback_params_t *feedback_param) {
+    (void)func_id;
+    (void)alt_itf;
+    feedback_param->method = AUDIO_FEEDBACK_METHOD_DISABLED;
+    feedback_param->sample_freq = current_sample_rate;
+}
+#endif